@@ -0,0 +1,166 @@
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "arrival.h"
+#include "backend.h"
+
+/* uniform in (0,1], to take the log of */
+static double positive_uniform()
+{
+  return 1.0 - jimsrand() * (1.0 - 1e-9);
+}
+
+static double exponential(double mean)
+{
+  return -mean * log(positive_uniform());
+}
+
+static double pareto(double mean, double shape)
+{
+  return mean * (shape - 1) / shape / pow(positive_uniform(), 1 / shape);
+}
+
+/* copies the next token of the current line to token, returns its */
+/* length, 0 at the end of the line                                 */
+static int next_token(arrival_t *arrival, char *token, int size)
+{
+  const char *trace = arrival->trace;
+  size_t i = arrival->cursor;
+  int n;
+
+  while (i < arrival->trace_size && (trace[i] == ' ' || trace[i] == '\t' || trace[i] == '\r'))
+    i++;
+  if (i < arrival->trace_size && trace[i] == '#')
+    while (i < arrival->trace_size && trace[i] != '\n')
+      i++;
+  /* the mapping is not NUL terminated, so copy the token out */
+  for (n = 0; i < arrival->trace_size && n < size - 1 && trace[i] > ' ' && trace[i] != '#'; n++)
+    token[n] = trace[i++];
+  token[n] = '\0';
+  arrival->cursor = i;
+  return n;
+}
+
+static void next_line(arrival_t *arrival)
+{
+  while (arrival->cursor < arrival->trace_size && arrival->trace[arrival->cursor] != '\n')
+    arrival->cursor++;
+  arrival->cursor++;
+}
+
+/* returns 1 and the next message of the entity in the trace, or 0 */
+static int next_record(arrival_t *arrival, double *time, int *flowid)
+{
+  char token[64];
+
+  for (; arrival->cursor < arrival->trace_size; next_line(arrival))
+  {
+    if (next_token(arrival, token, sizeof(token)) == 0)
+      continue;
+    *time = atof(token);
+    if (next_token(arrival, token, sizeof(token)) == 0 ||
+        token[0] != (arrival->entity == A ? 'A' : 'B'))
+      continue;
+    *flowid = next_token(arrival, token, sizeof(token)) > 0 ? atoi(token) : -1;
+    next_line(arrival);
+    return 1;
+  }
+  return 0;
+}
+
+int arrival_open(arrival_t *arrival, const emulator_params_t *params, int AorB)
+{
+  struct stat st;
+  int fd, other;
+
+  arrival->model = params->arrival[AorB];
+  if (AorB == B && !params->bidirectional)
+    arrival->model = ARRIVAL_NONE;
+  arrival->entity = AorB;
+  arrival->lambda = params->lambda;
+  arrival->share = 1;
+  other = AorB == A && !params->bidirectional ? ARRIVAL_NONE : params->arrival[!AorB];
+  if (other == ARRIVAL_UNIFORM || other == ARRIVAL_POISSON || other == ARRIVAL_ONOFF)
+    arrival->share = 2;
+  arrival->params = params;
+  arrival->on = 0;
+  arrival->period_end = 0;
+  arrival->trace = NULL;
+  arrival->trace_size = arrival->cursor = 0;
+  if (arrival->model != ARRIVAL_TRACE)
+    return 0;
+
+  if ((fd = open(params->arrival_trace, O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+  {
+    perror(params->arrival_trace);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  if (st.st_size > 0)
+    arrival->trace = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (arrival->trace == MAP_FAILED)
+  {
+    perror(params->arrival_trace);
+    arrival->trace = NULL;
+    return -1;
+  }
+  arrival->trace_size = st.st_size;
+  if (arrival->trace != NULL)
+    madvise((void *)arrival->trace, arrival->trace_size, MADV_SEQUENTIAL);
+  return 0;
+}
+
+double arrival_next(arrival_t *arrival, double now, int *flowid)
+{
+  const emulator_params_t *params = arrival->params;
+  double mean = arrival->lambda * arrival->share, t = now;
+
+  *flowid = -1;
+  switch (arrival->model)
+  {
+  case ARRIVAL_UNIFORM:
+    return now + mean * jimsrand() * 2;
+  case ARRIVAL_POISSON:
+    return now + exponential(mean);
+  case ARRIVAL_ONOFF:
+    for (;;)
+    {
+      if (arrival->on)
+      {
+        t += exponential(mean);
+        if (t <= arrival->period_end)
+          return t;
+        t = arrival->period_end;
+        arrival->on = 0;
+        arrival->period_end = t + pareto(params->off_time, params->pareto_shape);
+      }
+      else
+      {
+        if (t < arrival->period_end)
+          t = arrival->period_end;
+        arrival->on = 1;
+        arrival->period_end = t + pareto(params->on_time, params->pareto_shape);
+      }
+    }
+  case ARRIVAL_TRACE:
+    if (!next_record(arrival, &t, flowid))
+      return -1;
+    return t > now ? t : now;
+  default:
+    return -1;
+  }
+}
+
+void arrival_close(arrival_t *arrival)
+{
+  if (arrival->trace != NULL)
+    munmap((void *)arrival->trace, arrival->trace_size);
+  arrival->trace = NULL;
+  arrival->trace_size = arrival->cursor = 0;
+}
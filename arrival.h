@@ -0,0 +1,55 @@
+#ifndef ARRIVAL_H
+#define ARRIVAL_H
+#include <stddef.h>
+#include "emulator.h"
+
+/* ******************************************************************
+ ARRIVAL MODELS
+
+   Decides when layer 5 hands the next message to each entity, by
+   emulator_params_t arrival[AorB]:
+   - ARRIVAL_UNIFORM: gaps uniform on [0, 2*mean].  If both directions
+     use it, the emulator keeps its original single stream that picks
+     the entity of each message with a coin flip.
+   - ARRIVAL_POISSON: exponential gaps.
+   - ARRIVAL_ONOFF: Poisson arrivals during on periods, none during off
+     periods, their lengths drawn from Pareto distributions of means
+     on_time and off_time and shape pareto_shape.
+   - ARRIVAL_BULK: a saturating sender.  Layer 5 keeps bulk_depth
+     messages of every flow outstanding and writes the next one each
+     time one is delivered, so the sender is never short of data.
+   - ARRIVAL_TRACE: replays arrival_trace, a text file with one message
+     per line: its time, the entity ("A" or "B") and optionally the
+     flow, random if absent.  Times must not decrease.  '#' starts a
+     comment.  Each direction reads the lines of its entity, and sends
+     nothing more at the end of the trace.
+   - ARRIVAL_NONE: no messages, as from B when the run is
+     unidirectional.
+   As in the original stream, lambda is the mean gap between the
+   messages of both directions: when the other direction also draws
+   gaps from lambda, the mean gap of each is 2*lambda.
+**********************************************************************/
+
+typedef struct arrival_s
+{
+  int model;
+  int entity;        /* A or B */
+  float lambda;      /* emulator_params_t.lambda */
+  int share;         /* directions drawing gaps from lambda */
+  const emulator_params_t *params;
+  int on;            /* on/off: in an on period */
+  double period_end; /* on/off: end of the current period */
+  const char *trace; /* mapped arrival_trace */
+  size_t trace_size;
+  size_t cursor;     /* offset of the next line */
+} arrival_t;
+
+/* returns 0, or -1 (after printing why) if the trace can not be used */
+int arrival_open(arrival_t *arrival, const emulator_params_t *params, int AorB);
+/* returns the time of the first message after now and sets *flowid, -1  */
+/* to pick the flow at random.  Returns -1 if the model has no more      */
+/* timed arrivals: ARRIVAL_BULK is driven by deliveries instead.         */
+double arrival_next(arrival_t *arrival, double now, int *flowid);
+void arrival_close(arrival_t *arrival);
+
+#endif
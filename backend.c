@@ -0,0 +1,347 @@
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "backend.h"
+#include "latency.h"
+
+/* messages carry their number in the last STAMP_DIGITS letters of their */
+/* data, so a delivery can be matched with the time it entered layer 4.  */
+/* 26^7 letters hold any int.  The times are kept in a ring of the last  */
+/* STAMP_RING messages; a message still undelivered when a later one     */
+/* takes its slot moves to the overflow list, whose oldest entries are   */
+/* evicted once it holds STAMP_OVERFLOW.  The slots are shared by the    */
+/* workers of the parallel engine, so each stripe of them has a lock.    */
+#define STAMP_DIGITS 7
+#define STAMP_RING (26 * 26 * 26 * 26)
+#define STAMP_OVERFLOW 4096
+#define STAMP_LOCKS 64
+#define STAMP_EVICTED -2 /* take_stamp() of a message evicted from the list */
+
+int TRACE = 1; /* for my debugging */
+
+typedef struct stamp_s
+{
+  int n;       /* message number, -1 for none */
+  double time; /* layer 5 entry time, < 0 once delivered */
+} stamp_t;
+
+static stamp_t stamp[STAMP_RING];
+static pthread_mutex_t stamp_locks[STAMP_LOCKS] = {[0 ... STAMP_LOCKS - 1] =
+                                                       PTHREAD_MUTEX_INITIALIZER};
+static stamp_t overflow[STAMP_OVERFLOW]; /* a ring of undelivered messages out of */
+static int overflow_head, noverflow;     /* stamp, n -1 once delivered            */
+static int evicted_max;                  /* largest message number evicted, or -1 */
+static pthread_mutex_t overflow_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void init_random(unsigned int seed)
+{
+  int i;
+  float sum, avg;
+
+  srand(seed); /* init random number generator */
+  sum = 0.0;   /* test random number generator for students */
+  for (i = 0; i < 1000; i++)
+    sum = sum + jimsrand(); /* jimsrand() should be uniform in [0,1] */
+  avg = sum / 1000.0;
+  if (avg < 0.25 || avg > 0.75)
+  {
+    printf("It is likely that random number generation on your machine\n");
+    printf("is different from what this emulator expects.  Please take\n");
+    printf("a look at the routine jimsrand() in the emulator code. Sorry. \n");
+    exit(1);
+  }
+}
+
+/****************************************************************************/
+/* jimsrand(): return a float in range [0,1].  The routine below is used to */
+/* isolate all random number generation in one location.  We assume that the*/
+/* system-supplied rand() function return an int in therange [0,mmm]        */
+/****************************************************************************/
+float jimsrand()
+{
+  double mmm = 2147483647; /* largest int  - MACHINE DEPENDENT!!!!!!!!   */
+  float x;                 /* individual students may need to change mmm */
+  x = rand() / mmm;        /* x should be uniform in [0,1] */
+  return (x);
+}
+
+/* splitmix64 of the seed and stream picks the starting state, */
+/* xorshift64* generates from it                                */
+void rng_seed(rng_t *rng, unsigned int seed, unsigned long long stream)
+{
+  unsigned long long z = ((unsigned long long)seed << 32) + stream * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+  *rng = z != 0 ? z : 1;
+}
+
+float rng_float(rng_t *rng)
+{
+  *rng ^= *rng >> 12;
+  *rng ^= *rng << 25;
+  *rng ^= *rng >> 27;
+  return ((*rng * 0x2545f4914f6cdd1dULL) >> 40) / 16777216.0f;
+}
+
+static void make_message(msg_t *message, int n)
+{
+  int i, j;
+
+  /* fill in msg to give with string of same letter */
+  j = n % 26;
+  for (i = 0; i < 20; i++)
+    message->data[i] = 97 + j;
+  /* followed by the message number, in base 26 */
+  for (i = 19; i >= 20 - STAMP_DIGITS; i--)
+  {
+    message->data[i] = 97 + n % 26;
+    n /= 26;
+  }
+}
+
+/* returns the number of the message whose data was delivered, or -1 */
+static int match_message(char *data)
+{
+  msg_t expected;
+  long long n = 0;
+  int i;
+
+  for (i = 20 - STAMP_DIGITS; i < 20; i++)
+  {
+    if (data[i] < 97 || data[i] >= 97 + 26)
+      return -1;
+    n = n * 26 + (data[i] - 97);
+  }
+  if (n > INT_MAX)
+    return -1;
+  make_message(&expected, n);
+  for (i = 0; i < 20 - STAMP_DIGITS; i++)
+    if (data[i] != expected.data[i])
+      return -1;
+  return n;
+}
+
+void layer5_reset()
+{
+  int i;
+
+  for (i = 0; i < STAMP_RING; i++)
+    stamp[i] = (stamp_t){-1, -1};
+  overflow_head = noverflow = 0;
+  evicted_max = -1;
+}
+
+/* adds an undelivered message to the overflow list, evicting the oldest */
+/* entry if it is full                                                   */
+static void add_overflow(const stamp_t *entry)
+{
+  stamp_t *oldest;
+
+  pthread_mutex_lock(&overflow_lock);
+  if (noverflow == STAMP_OVERFLOW)
+  {
+    oldest = &overflow[overflow_head];
+    if (oldest->n > evicted_max)
+      evicted_max = oldest->n;
+    overflow_head = (overflow_head + 1) % STAMP_OVERFLOW;
+    noverflow--;
+  }
+  overflow[(overflow_head + noverflow++) % STAMP_OVERFLOW] = *entry;
+  pthread_mutex_unlock(&overflow_lock);
+}
+
+void layer5_message(msg_t *message, int n, double now)
+{
+  pthread_mutex_t *lock = &stamp_locks[n % STAMP_RING % STAMP_LOCKS];
+  stamp_t *slot = &stamp[n % STAMP_RING];
+  int i;
+
+  make_message(message, n);
+  if (TRACE > 2)
+  {
+    printf("          MAINLOOP: data given to student: ");
+    for (i = 0; i < 20; i++)
+      printf("%c", message->data[i]);
+    printf("\n");
+  }
+  pthread_mutex_lock(lock);
+  if (slot->n >= 0 && slot->n != n && slot->time >= 0)
+    add_overflow(slot);
+  slot->n = n;
+  slot->time = now;
+  pthread_mutex_unlock(lock);
+}
+
+/* returns the entry time of message n if it is still undelivered and */
+/* marks it delivered, STAMP_EVICTED if it may have been evicted from  */
+/* the overflow list, or -1                                            */
+static double take_stamp(int n)
+{
+  pthread_mutex_t *lock = &stamp_locks[n % STAMP_RING % STAMP_LOCKS];
+  stamp_t *slot = &stamp[n % STAMP_RING];
+  double time = -1;
+  int i;
+
+  pthread_mutex_lock(lock);
+  if (slot->n == n)
+  {
+    time = slot->time;
+    slot->time = -1;
+    pthread_mutex_unlock(lock);
+    return time;
+  }
+  pthread_mutex_unlock(lock);
+  /* a message out of the ring that is not in the list was delivered, */
+  /* unless it was evicted                                            */
+  pthread_mutex_lock(&overflow_lock);
+  for (i = noverflow - 1; i >= 0; i--)
+    if (overflow[(overflow_head + i) % STAMP_OVERFLOW].n == n)
+    {
+      time = overflow[(overflow_head + i) % STAMP_OVERFLOW].time;
+      overflow[(overflow_head + i) % STAMP_OVERFLOW].n = -1;
+      break;
+    }
+  if (i < 0 && n <= evicted_max)
+    time = STAMP_EVICTED;
+  pthread_mutex_unlock(&overflow_lock);
+  return time;
+}
+
+int layer5_deliver(emulator_stats_t *stats, char *data, double now)
+{
+  double entered;
+  int i, n;
+  if (TRACE > 2)
+  {
+    printf("          TOLAYER5: data received: ");
+    for (i = 0; i < 20; i++)
+      printf("%c", data[i]);
+    printf("\n");
+  }
+
+  stats->bytes_delivered += sizeof(msg_t);
+  n = match_message(data);
+  if (n < 0)
+    stats->nbad++;
+  else if ((entered = take_stamp(n)) == STAMP_EVICTED)
+  {
+    /* delivered, or a duplicate that can not be told, with no latency */
+    stats->nunstamped++;
+    return 1;
+  }
+  else if (entered < 0)
+    stats->nduplicate++;
+  else
+  {
+    stats->ndelivered++;
+    stats->latency_sum += now - entered;
+    latency_add(&stats->latency, now - entered);
+    return 1;
+  }
+  return 0;
+}
+
+static __thread memory_stats_t memory_counters[MEMORY_CATEGORIES];
+static __thread size_t memory_total, memory_peak;
+
+void memory_add(int category, long bytes)
+{
+  memory_stats_t *counter = &memory_counters[category];
+
+  counter->current += bytes;
+  memory_total += bytes;
+  if (bytes > 0)
+  {
+    counter->nallocs++;
+    if (counter->current > counter->peak)
+      counter->peak = counter->current;
+    if (memory_total > memory_peak)
+      memory_peak = memory_total;
+  }
+}
+
+void *memory_alloc(int category, size_t size)
+{
+  memory_add(category, size);
+  return malloc(size);
+}
+
+void memory_free(int category, void *p, size_t size)
+{
+  if (p == NULL)
+    return;
+  memory_add(category, -(long)size);
+  free(p);
+}
+
+void memory_reset()
+{
+  for (int i = 0; i < MEMORY_CATEGORIES; i++)
+    memory_counters[i] = (memory_stats_t){0};
+  memory_total = memory_peak = 0;
+}
+
+void memory_get(memory_stats_t *memory, size_t *peak)
+{
+  for (int i = 0; i < MEMORY_CATEGORIES; i++)
+    memory[i] = memory_counters[i];
+  if (peak != NULL)
+    *peak = memory_peak;
+}
+
+void corrupt_packet(pkt_t *packet, float x)
+{
+  if (x < .75)
+    packet->payload[0] = 'Z'; /* corrupt payload */
+  else if (x < .875)
+    packet->seqnum = 999999;
+  else
+    packet->acknum = 999999;
+}
+
+/* error free bits before the next error */
+static long next_gap(bit_errors_t *errors)
+{
+  double u, gap;
+
+  if (errors->log_good == 0)
+    return LONG_MAX;
+  while ((u = 1 - jimsrand()) <= 0) /* jimsrand() can return 1 */
+    ;
+  if ((gap = floor(log(u) / errors->log_good)) >= LONG_MAX)
+    return LONG_MAX;
+  return gap;
+}
+
+void bit_errors_init(bit_errors_t *errors, double ber)
+{
+  errors->log_good = ber < 1 ? log(1 - ber) : -INFINITY;
+  errors->gap = next_gap(errors);
+}
+
+int corrupt_bits(bit_errors_t *errors, pkt_t *packet)
+{
+  long bit = errors->gap, gap;
+  int n = 0;
+
+  while (bit < BIT_ERROR_BITS)
+  {
+    if (bit < 32)
+      packet->seqnum ^= 1u << bit;
+    else if (bit < 64)
+      packet->acknum ^= 1u << (bit - 32);
+    else if (bit < 96)
+      packet->checksum ^= 1u << (bit - 64);
+    else
+      packet->payload[(bit - 96) / 8] ^= 1 << (bit % 8);
+    n++;
+    gap = next_gap(errors);
+    bit = gap == LONG_MAX ? LONG_MAX : bit + 1 + gap;
+  }
+  /* the gap runs on into the next packet */
+  errors->gap = bit == LONG_MAX ? LONG_MAX : bit - BIT_ERROR_BITS;
+  return n;
+}
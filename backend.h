@@ -0,0 +1,54 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+#include "emulator.h"
+
+/* routines shared by the network backends (emulator.c, udp.c) that run */
+/* protocol_t entities: random numbers, layer 5 messages and the media  */
+/* corruption model.                                                    */
+
+void init_random(unsigned int seed);
+float jimsrand();
+
+/* independent random streams, for backends that can not share rand() */
+typedef unsigned long long rng_t;
+void rng_seed(rng_t *rng, unsigned int seed, unsigned long long stream);
+float rng_float(rng_t *rng); /* uniform in [0,1) */
+
+/* forgets the messages of the previous run, before a run starts */
+void layer5_reset();
+/* fills message with the data of the n-th message from layer 5 and */
+/* records that it entered layer 4 at time now                      */
+void layer5_message(msg_t *message, int n, double now);
+/* accounts for data delivered to layer 5 at time now, returns 1 if it */
+/* is a message delivered for the first time                           */
+int layer5_deliver(emulator_stats_t *stats, char *data, double now);
+
+/* memory accounting of memory_alloc() and memory_free().  The counters */
+/* are per thread like the protocol state, so each worker of a backend  */
+/* counts its own.                                                      */
+void memory_add(int category, long bytes); /* for memory sized by realloc() */
+void memory_reset();
+/* copies the counters to memory, and the peak of their total to *peak */
+void memory_get(memory_stats_t *memory, size_t *peak);
+
+/* applies the media corruption model to packet, x is uniform in [0,1] */
+void corrupt_packet(pkt_t *packet, float x);
+
+/* bit errors of one direction of the medium, each bit of the packets   */
+/* flipped with probability ber.  The gap to the next error is drawn    */
+/* from the geometric distribution, so error free bits cost nothing.    */
+/* The flowid addresses the flow like the IP/UDP header the network     */
+/* checks itself, so only seqnum, acknum, checksum and payload are hit. */
+#define BIT_ERROR_BITS ((3 * 4 + 20) * 8)
+
+typedef struct bit_errors_s
+{
+  double log_good; /* log of the probability that a bit is error free */
+  long gap;        /* error free bits before the next error */
+} bit_errors_t;
+
+void bit_errors_init(bit_errors_t *errors, double ber);
+/* flips the bits of packet that errors hits, returns how many */
+int corrupt_bits(bit_errors_t *errors, pkt_t *packet);
+
+#endif
@@ -0,0 +1,55 @@
+#include "emulator.c"
+#include "bench.h"
+
+static const protocol_t bench_protocol = {"bench", NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+
+void bench_emulator_setup(const emulator_params_t *params, emulator_stats_t *run_stats)
+{
+  protocol = &bench_protocol;
+  stats = run_stats;
+  simparams = *params;
+  loss_open(&loss, &simparams);
+  init(&simparams);
+  while (nevlist > 0) /* the first layer 5 arrival */
+    bench_pop_event();
+}
+
+void bench_emulator_teardown(void)
+{
+  while (nevlist > 0)
+    bench_pop_event();
+  popevent(); /* releases evlist */
+  conn_table_clear(&timers, NULL);
+  loss_close(&loss);
+}
+
+void bench_insert_event(double evtime)
+{
+  event_t *evptr = (event_t *)memory_alloc(MEMORY_EVENTS, sizeof(event_t));
+
+  evptr->evtime = evtime;
+  evptr->evtype = FROM_LAYER5;
+  evptr->eventity = A;
+  evptr->flowid = 0;
+  evptr->pktptr = NULL;
+  insertevent(evptr);
+}
+
+double bench_pop_event(void)
+{
+  event_t *evptr = popevent();
+  double evtime;
+
+  if (evptr == NULL)
+    return -1;
+  evtime = evptr->evtime;
+  if (evptr->evtype == TIMER_INTERRUPT)
+    conn_table_put(&timers, TIMER_KEY(evptr->eventity, evptr->flowid), NULL);
+  free_event(evptr);
+  return evtime;
+}
+
+int bench_pending_events(void)
+{
+  return nevlist;
+}
@@ -0,0 +1,19 @@
+#include "tcp-goback-n.c"
+#include "bench.h"
+
+void *bench_gbn_caller(int AorB, int flowid)
+{
+  return get_caller(AorB, flowid);
+}
+
+void bench_gbn_output(void *caller, pkt_t *packet)
+{
+  add_to_window((caller_state_t *)caller, packet);
+  send_authorized((caller_state_t *)caller);
+}
+
+void bench_gbn_reset(void)
+{
+  init(A);
+  init(B);
+}
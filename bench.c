@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bench.h"
+#include "emulator.h"
+#include "options.h"
+#include "packet.h"
+#include "protocols.h"
+
+/* microbenchmarks of the hot paths of the emulator and of go-back-n at  */
+/* several event list and window sizes, and macrobenchmarks of whole    */
+/* runs at fixed seeds.  Results are written as JSON, one benchmark per */
+/* line, and compared with a baseline written by an earlier run on the  */
+/* same machine, as the timings are absolute.                           */
+
+#define REPEATS 3 /* every benchmark is timed this many times, the best counts */
+#define MAX_RESULTS 64
+
+typedef struct result_s
+{
+  char name[64];
+  double ns_per_op;
+  double events_per_second; /* macrobenchmarks only */
+} result_t;
+
+static result_t results[MAX_RESULTS];
+static int nresults;
+static volatile int sink; /* keeps results of the measured routines alive */
+static unsigned long long seed = 88172645463325252ULL;
+
+static double wall_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* uniform in [0,1), cheaper than the emulator's generator */
+static double uniform()
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 7;
+  seed ^= seed << 17;
+  return (seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void bench_params(emulator_params_t *params)
+{
+  emulator_default_params(params);
+  params->trace = 0;
+}
+
+static double bench_checksum(int size)
+{
+  pkt_t packet = {0, 1234, 5678, 0, "abcdefghijklmnopqrs", ECN_NOT_ECT};
+  double start = wall_clock();
+  int i, n = 2000000, sum = 0;
+
+  (void)size;
+  for (i = 0; i < n; i++)
+  {
+    packet.seqnum = i;
+    sum += get_checksum(&packet);
+  }
+  sink = sum;
+  return (wall_clock() - start) * 1e9 / n;
+}
+
+/* the hold model: pop the earliest event, insert one a random time later */
+static double bench_event_list(int size)
+{
+  emulator_params_t params;
+  emulator_stats_t stats;
+  double start, elapsed, now = 0;
+  int i, n = 1000000;
+
+  bench_params(&params);
+  bench_emulator_setup(&params, &stats);
+  for (i = 0; i < size; i++)
+    bench_insert_event(uniform() * size);
+  start = wall_clock();
+  for (i = 0; i < n; i++)
+  {
+    bench_insert_event(now + uniform() * size);
+    now = bench_pop_event();
+  }
+  elapsed = wall_clock() - start;
+  bench_emulator_teardown();
+  return elapsed * 1e9 / n;
+}
+
+/* a timer started and stopped while size other flows have timers running */
+static double bench_timers(int size)
+{
+  emulator_params_t params;
+  emulator_stats_t stats;
+  double start, elapsed;
+  int i, n = 1000000;
+
+  bench_params(&params);
+  params.nflows = size + 1;
+  bench_emulator_setup(&params, &stats);
+  for (i = 1; i <= size; i++)
+    starttimer(A, i, 1000 + uniform() * size);
+  start = wall_clock();
+  for (i = 0; i < n; i++)
+  {
+    starttimer(A, 0, 10 + (i & 7));
+    stoptimer(A, 0);
+  }
+  elapsed = wall_clock() - start;
+  bench_emulator_teardown();
+  return elapsed * 1e9 / n;
+}
+
+/* messages added to a go-back-n window until it holds size packets */
+static double bench_window(int size)
+{
+  emulator_params_t params;
+  emulator_stats_t stats;
+  msg_t message = {"abcdefghijklmnopqrs"};
+  pkt_t **packets = (pkt_t **)malloc(size * sizeof(pkt_t *));
+  double elapsed = 0, start;
+  void *caller;
+  int i, rep, nreps = 2000000 / size + 1;
+
+  bench_params(&params);
+  params.lossprob = params.corruptprob = 0;
+  bench_emulator_setup(&params, &stats);
+  for (rep = 0; rep < nreps; rep++)
+  {
+    for (i = 0; i < size; i++)
+      packets[i] = get_pkt_from_msg(&message, 0, i * 20, 0);
+    caller = bench_gbn_caller(A, 0);
+    start = wall_clock();
+    for (i = 0; i < size; i++)
+      bench_gbn_output(caller, packets[i]);
+    elapsed += wall_clock() - start;
+    bench_gbn_reset(); /* frees the packets */
+    while (bench_pending_events() > 0)
+      bench_pop_event();
+  }
+  bench_emulator_teardown();
+  free(packets);
+  return elapsed * 1e9 / ((double)nreps * size);
+}
+
+/* batches of packets sent while size events are pending */
+static double bench_tolayer3(int size)
+{
+  emulator_params_t params;
+  emulator_stats_t stats;
+  msg_t message = {"abcdefghijklmnopqrs"};
+  pkt_t *packet = get_pkt_from_msg(&message, 0, 0, 0);
+  double elapsed = 0, start;
+  int i, rep, batch = 1000, nreps = 1000;
+
+  bench_params(&params);
+  bench_emulator_setup(&params, &stats);
+  for (i = 0; i < size; i++)
+    bench_insert_event(1e18); /* stays behind every packet */
+  for (rep = 0; rep < nreps; rep++)
+  {
+    start = wall_clock();
+    for (i = 0; i < batch; i++)
+      tolayer3(A, *packet);
+    elapsed += wall_clock() - start;
+    while (bench_pending_events() > size)
+      bench_pop_event();
+  }
+  bench_emulator_teardown();
+  memory_free(MEMORY_WINDOW, packet, sizeof(pkt_t));
+  return elapsed * 1e9 / ((double)nreps * batch);
+}
+
+typedef struct micro_s
+{
+  const char *name;
+  double (*run)(int size);
+  int sizes[4]; /* 0 terminated */
+} micro_t;
+
+static const micro_t micros[] = {
+    {"get_checksum", bench_checksum, {1}},
+    {"insertevent+popevent", bench_event_list, {10, 1000, 100000}},
+    {"starttimer+stoptimer", bench_timers, {10, 1000, 100000}},
+    {"add_to_window+send_authorized", bench_window, {5, 100, 1000}},
+    {"tolayer3", bench_tolayer3, {1, 10000, 100000}},
+    {NULL}};
+
+typedef struct macro_s
+{
+  const char *name;
+  const char *protocol;
+  const char *options; /* emulator options, as on the command line */
+} macro_t;
+
+static const macro_t macros[] = {
+    {"gbn/100-flows", "gbn", "-n 100000 -f 100 -t 40 -l .02 -c .02"},
+    {"alt-bit/100-flows", "alt-bit", "-n 100000 -f 100 -t 40 -l .02 -c .02"},
+    {"gbn/link-red", "gbn", "-n 100000 -f 100 -t 40 -l .02 -c .02 -b 20 -Q red"},
+    {"gbn/bit-errors", "gbn", "-n 100000 -f 100 -t 40 -l .02 -e 1e-4"},
+    {NULL}};
+
+static void add_result(const char *name, double ns_per_op, double events_per_second)
+{
+  result_t *result = &results[nresults++];
+
+  snprintf(result->name, sizeof(result->name), "%s", name);
+  result->ns_per_op = ns_per_op;
+  result->events_per_second = events_per_second;
+  fprintf(stderr, "%-40s %12.2f ns\n", name, ns_per_op);
+}
+
+static void run_micro(const micro_t *micro)
+{
+  char name[64];
+  double best, ns;
+  int i, rep;
+
+  for (i = 0; i < 4 && micro->sizes[i] != 0; i++)
+  {
+    best = 0;
+    for (rep = 0; rep < REPEATS; rep++)
+      if ((ns = micro->run(micro->sizes[i])) < best || rep == 0)
+        best = ns;
+    if (micro->run == bench_checksum)
+      snprintf(name, sizeof(name), "%s", micro->name);
+    else
+      snprintf(name, sizeof(name), "%s/%d", micro->name, micro->sizes[i]);
+    add_result(name, best, 0);
+  }
+}
+
+static void run_macro(const macro_t *macro)
+{
+  emulator_params_t params;
+  emulator_stats_t stats;
+  char options[256], *argv[32], name[64];
+  double start, ns, best = 0;
+  int argc = 1, opt, rep;
+
+  bench_params(&params);
+  snprintf(options, sizeof(options), "%s", macro->options);
+  argv[0] = "bench";
+  for (argv[argc] = strtok(options, " "); argv[argc] != NULL && argc < 31;)
+    argv[++argc] = strtok(NULL, " ");
+  optind = 1;
+  while ((opt = getopt(argc, argv, EMULATOR_OPTIONS)) != -1)
+    emulator_option(opt, optarg, &params);
+
+  for (rep = 0; rep < REPEATS; rep++)
+  {
+    start = wall_clock();
+    emulator_run(find_protocol(macro->protocol), &params, &stats);
+    emulator_close();
+    ns = (wall_clock() - start) * 1e9 / stats.nevents;
+    if (ns < best || rep == 0)
+      best = ns;
+  }
+  snprintf(name, sizeof(name), "macro/%s", macro->name);
+  add_result(name, best, 1e9 / best);
+}
+
+static void write_results(FILE *out)
+{
+  int i;
+
+  fprintf(out, "{\"benchmarks\": [\n");
+  for (i = 0; i < nresults; i++)
+  {
+    fprintf(out, "  {\"name\": \"%s\", \"ns_per_op\": %.3f", results[i].name,
+            results[i].ns_per_op);
+    if (results[i].events_per_second > 0)
+      fprintf(out, ", \"events_per_second\": %.0f", results[i].events_per_second);
+    fprintf(out, "}%s\n", i < nresults - 1 ? "," : "");
+  }
+  fprintf(out, "]}\n");
+}
+
+/* returns the number of benchmarks more than threshold percent slower */
+/* than in baseline, a file written by write_results()                 */
+static int compare_results(const char *path, double threshold)
+{
+  FILE *in = fopen(path, "r");
+  char line[256], name[64];
+  double base, change;
+  int i, found, nregressions = 0;
+
+  if (in == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  printf("%-40s %12s %12s %8s\n", "benchmark", "baseline ns", "current ns", "change");
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    if (sscanf(line, " {\"name\": \"%63[^\"]\", \"ns_per_op\": %lf", name, &base) != 2)
+      continue;
+    for (i = 0, found = 0; i < nresults && !found; i++)
+    {
+      if (strcmp(results[i].name, name) != 0)
+        continue;
+      found = 1;
+      change = 100 * (results[i].ns_per_op - base) / base;
+      printf("%-40s %12.2f %12.2f %+7.1f%%%s\n", name, base, results[i].ns_per_op, change,
+             change > threshold ? "  REGRESSION" : "");
+      nregressions += change > threshold;
+    }
+    if (!found)
+      printf("%-40s %12.2f %12s\n", name, base, "missing");
+  }
+  fclose(in);
+  return nregressions;
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-o results.json] [-b baseline.json] [-r percent] [-m]\n", prog);
+  fprintf(stderr, "  -o file     write the results to file instead of stdout\n");
+  fprintf(stderr, "  -b file     compare the results with a baseline\n");
+  fprintf(stderr, "  -r percent  slowdown reported as a regression (default 10)\n");
+  fprintf(stderr, "  -m          microbenchmarks only\n");
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  const char *output = NULL, *baseline = NULL;
+  double threshold = 10;
+  int opt, micro_only = 0, i, nregressions = 0;
+  FILE *out = stdout;
+
+  while ((opt = getopt(argc, argv, "o:b:r:m")) != -1)
+  {
+    if (opt == 'o')
+      output = optarg;
+    else if (opt == 'b')
+      baseline = optarg;
+    else if (opt == 'r')
+      threshold = atof(optarg);
+    else if (opt == 'm')
+      micro_only = 1;
+    else
+      usage(argv[0]);
+  }
+
+  for (i = 0; micros[i].name != NULL; i++)
+    run_micro(&micros[i]);
+  for (i = 0; !micro_only && macros[i].name != NULL; i++)
+    run_macro(&macros[i]);
+
+  if (output != NULL && (out = fopen(output, "w")) == NULL)
+  {
+    perror(output);
+    return 1;
+  }
+  write_results(out);
+  if (out != stdout)
+    fclose(out);
+  if (baseline != NULL && (nregressions = compare_results(baseline, threshold)) != 0)
+    return 1;
+  return 0;
+}
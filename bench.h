@@ -0,0 +1,21 @@
+#ifndef BENCH_H
+#define BENCH_H
+#include "emulator.h"
+
+/* entry points into the internals of the emulator and of go-back-n for */
+/* the microbenchmarks of bench.c.  bench-emulator.c and bench-gbn.c    */
+/* include emulator.c and tcp-goback-n.c and take their place in bench. */
+
+/* sets the emulator up as emulator_run() does, without running it */
+void bench_emulator_setup(const emulator_params_t *params, emulator_stats_t *stats);
+void bench_emulator_teardown(void);
+void bench_insert_event(double evtime); /* inserts a layer 5 arrival */
+double bench_pop_event(void);           /* frees the earliest event, returns its time */
+int bench_pending_events(void);
+
+void *bench_gbn_caller(int AorB, int flowid);
+/* add_to_window() then send_authorized() */
+void bench_gbn_output(void *caller, pkt_t *packet);
+void bench_gbn_reset(void); /* closes every go-back-n flow */
+
+#endif
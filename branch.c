@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "emulator.h"
+#include "options.h"
+#include "protocols.h"
+
+/* runs a protocol up to a branch time once, then forks a variant for */
+/* every -V loss probability and prints what each does from there on  */
+
+#define MAX_VARIANTS 64
+
+typedef struct variants_s
+{
+  float lossprob[MAX_VARIANTS + 1]; /* index 0 is the unchanged run */
+  double start;                     /* wall clock when this variant started */
+} variants_t;
+
+static double wall_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-p protocol] [-B time] [-V lossprob]... [options]\n", prog);
+  fprintf(stderr, "  -p name     protocol to run:");
+  for (int i = 0; protocols[i] != NULL; i++)
+    fprintf(stderr, " %s", protocols[i]->name);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  -B time     simulation time to branch at\n");
+  fprintf(stderr, "  -V prob     loss probability of a variant after the branch\n");
+  emulator_usage(stderr);
+  exit(1);
+}
+
+static void vary(int n, emulator_params_t *params, void *arg)
+{
+  variants_t *variants = (variants_t *)arg;
+
+  params->lossprob = variants->lossprob[n];
+  variants->start = wall_clock();
+}
+
+int main(int argc, char **argv)
+{
+  const protocol_t *protocol = &goback_n_protocol;
+  emulator_params_t params;
+  emulator_stats_t stats;
+  emulator_branch_t branch = {0};
+  variants_t variants;
+  emulator_stats_t *at;
+  int opt, variant, delivered;
+
+  emulator_default_params(&params);
+  params.nsimmax = 20000;
+  params.lossprob = 0.02;
+  params.corruptprob = 0.02;
+  params.lambda = 20;
+  params.trace = 0;
+  branch.time = -1;
+  while ((opt = getopt(argc, argv, "p:B:V:" EMULATOR_OPTIONS)) != -1)
+  {
+    if (opt == 'p')
+    {
+      if ((protocol = find_protocol(optarg)) == NULL)
+        usage(argv[0]);
+    }
+    else if (opt == 'B')
+    {
+      if ((branch.time = atof(optarg)) < 0)
+        usage(argv[0]);
+    }
+    else if (opt == 'V')
+    {
+      if (branch.nvariants == MAX_VARIANTS)
+        usage(argv[0]);
+      variants.lossprob[++branch.nvariants] = atof(optarg);
+    }
+    else if (emulator_option(opt, optarg, &params) != 1)
+      usage(argv[0]);
+  }
+  if (branch.time < 0)
+    branch.time = params.nsimmax * params.lambda / 2; /* half way */
+  if (branch.nvariants == 0)
+  {
+    variants.lossprob[++branch.nvariants] = 0.1;
+    variants.lossprob[++branch.nvariants] = 0.3;
+  }
+  variants.lossprob[0] = params.lossprob;
+  branch.vary = vary;
+  branch.arg = &variants;
+
+  printf("%s, %d msgs, branching at time %.1f into %d variants\n\n", protocol->name,
+         params.nsimmax, branch.time, branch.nvariants);
+  printf("%7s %9s %9s %9s %11s %11s %11s %9s\n", "variant", "loss", "delivered",
+         "tolayer3", "throughput", "latency", "events", "wall ms");
+  variant = emulator_run_branch(protocol, &params, &branch, &stats);
+  if (variant < 0)
+    return 1;
+  if (!branch.branched)
+  {
+    printf("the run ended at time %.1f, before the branch\n", stats.time);
+    return 1;
+  }
+
+  /* everything from the branch on */
+  at = &branch.at_branch;
+  delivered = stats.ndelivered - at->ndelivered;
+  printf("%7d %9.3f %9d %9d %11.5f %11.2f %11ld %9.2f\n", variant,
+         variants.lossprob[variant], delivered, stats.ntolayer3 - at->ntolayer3,
+         stats.time > at->time ? delivered / (stats.time - at->time) : 0.0,
+         delivered > 0 ? (stats.latency_sum - at->latency_sum) / delivered : 0.0,
+         stats.nevents - at->nevents, (wall_clock() - variants.start) * 1e3);
+  if (variant == 0)
+    printf("\nwarm-up of %ld events simulated once instead of %d times\n",
+           at->nevents, branch.nvariants + 1);
+  return emulator_close() < 0 ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "emulator.h"
+#include "latency.h"
+#include "options.h"
+#include "protocols.h"
+
+/* runs every registered protocol under the same seed and parameters */
+/* and prints their throughput, mean and p99 latency, queueing delay  */
+/* per packet and burst sizes side by side, and with the link model   */
+/* the drops and ECN marks at the links                               */
+
+static double wall_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+  emulator_params_t params;
+  emulator_stats_t stats;
+  double start, elapsed, queueing;
+  long npackets;
+  int opt;
+
+  emulator_default_params(&params);
+  params.nsimmax = 1000;
+  params.trace = 0;
+  while ((opt = getopt(argc, argv, EMULATOR_OPTIONS)) != -1)
+  {
+    if (emulator_option(opt, optarg, &params) != 1)
+    {
+      fprintf(stderr, "usage: %s [options]\n", argv[0]);
+      emulator_usage(stderr);
+      return 1;
+    }
+  }
+
+  printf("msgs %d, loss %.3f, corrupt %.3f, lambda %.2f, seed %u\n\n",
+         params.nsimmax, params.lossprob, params.corruptprob, params.lambda,
+         params.seed);
+  printf("%-10s %9s %9s %9s %9s %11s %11s %11s %11s %9s %9s %6s %6s", "protocol", "sent",
+         "delivered", "dup", "tolayer3", "sim time", "throughput", "latency", "p99",
+         "wall ms", "queueing", "burst", "max");
+  if (params.bandwidth > 0)
+    printf(" %9s %9s", "dropped", "marked");
+  printf("\n");
+  for (int i = 0; protocols[i] != NULL; i++)
+  {
+    start = wall_clock();
+    if (emulator_run(protocols[i], &params, &stats) < 0)
+      return 1;
+    elapsed = wall_clock() - start;
+    printf("%-10s %9d %9d %9d %9d %11.1f %11.5f %11.2f %11.2f %9.2f",
+           protocols[i]->name, stats.nsim, stats.ndelivered, stats.nduplicate,
+           stats.ntolayer3, stats.time,
+           stats.time > 0 ? stats.ndelivered / stats.time : 0.0,
+           stats.ndelivered > 0 ? stats.latency_sum / stats.ndelivered : 0.0,
+           latency_percentile(&stats.latency, 99), elapsed * 1e3);
+    if (params.bandwidth > 0)
+    {
+      npackets = stats.link[A].npackets + stats.link[B].npackets;
+      queueing = stats.link[A].delay_sum + stats.link[B].delay_sum;
+    }
+    else
+    {
+      npackets = stats.ntolayer3 - stats.nlost;
+      queueing = stats.medium_queueing;
+    }
+    printf(" %9.3f %6.2f %6d", npackets > 0 ? queueing / npackets : 0.0,
+           stats.nbursts[A] + stats.nbursts[B] > 0
+               ? (double)stats.ntolayer3 / (stats.nbursts[A] + stats.nbursts[B])
+               : 0.0,
+           stats.max_burst[A] > stats.max_burst[B] ? stats.max_burst[A] : stats.max_burst[B]);
+    if (params.bandwidth > 0)
+    {
+      link_stats_t *a = &stats.link[A], *b = &stats.link[B];
+
+      printf(" %9ld %9ld", a->ndropped + a->nearly + b->ndropped + b->nearly,
+             a->nmarked + b->nmarked);
+    }
+    printf("\n");
+  }
+  return emulator_close() < 0 ? 1 : 0;
+}
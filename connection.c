@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <string.h>
+#include "connection.h"
+#include "packet.h"
+
+/* ISN of connection n of entity AorB on flowid, AorB + 2 for those it */
+/* accepts                                                             */
+static int isn(int AorB, int flowid, int n)
+{
+  unsigned long long x = ((unsigned long long)flowid << 34) ^ ((unsigned long long)n << 2) ^ AorB;
+
+  /* splitmix64 */
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x & 0x3fffffff; /* leaves room for the sequence numbers to grow */
+}
+
+static void control_packet(pkt_t *packet, int flowid, int seqnum, int acknum, const char *data)
+{
+  packet->flowid = flowid;
+  packet->seqnum = seqnum;
+  packet->acknum = acknum;
+  if (data != NULL)
+    memcpy(packet->payload, data, 20);
+  else
+    memset(packet->payload, 0, 20);
+  packet->checksum = get_checksum(packet);
+  packet->ecn = ECN_NOT_ECT;
+}
+
+void connection_init(connection_t *connection, int mode)
+{
+  memset(connection, 0, sizeof(*connection));
+  if (mode == HANDSHAKE_NONE)
+    connection->state = connection->peer_state = CONNECTION_ESTABLISHED;
+}
+
+void connection_open(connection_t *connection, int AorB, int flowid, double now)
+{
+  connection->isn = isn(AorB, flowid, connection->nopened++);
+  connection->state = CONNECTION_SYN_SENT;
+  connection->opened = now;
+  connection->first_byte_seen = 0;
+}
+
+void connection_syn(const connection_t *connection, pkt_t *packet, int flowid, const char *data)
+{
+  control_packet(packet, flowid, connection->isn,
+                 data != NULL ? CONNECTION_SYN_DATA : CONNECTION_SYN, data);
+}
+
+void connection_established(connection_t *connection, const pkt_t *syn_ack, pkt_t *packet)
+{
+  connection->state = CONNECTION_ESTABLISHED;
+  connection_acked(connection, syn_ack);
+  control_packet(packet, syn_ack->flowid, connection->isn + 1, CONNECTION_ACK, NULL);
+}
+
+void connection_acked(connection_t *connection, const pkt_t *ack)
+{
+  double first_byte;
+
+  memcpy(&first_byte, ack->payload + 12, sizeof(double));
+  /* an ACK of an earlier connection has an earlier time, or none */
+  if (connection->first_byte_seen || first_byte == 0 || first_byte < connection->opened)
+    return;
+  connection->first_byte_seen = 1;
+  connection->nttfb++;
+  connection->ttfb_sum += first_byte - connection->opened;
+}
+
+void connection_fin(connection_t *connection, pkt_t *packet, int flowid, int seqnum)
+{
+  connection->state = CONNECTION_FIN_SENT;
+  connection->fin_seqnum = seqnum;
+  control_packet(packet, flowid, seqnum, CONNECTION_FIN, NULL);
+}
+
+int connection_fin_acked(const connection_t *connection, const pkt_t *ack)
+{
+  return connection->state == CONNECTION_FIN_SENT && ack->payload[11] == CONNECTION_FIN_ACK &&
+         ack->acknum == connection->fin_seqnum + 1;
+}
+
+void connection_close(connection_t *connection, double now)
+{
+  connection->state = CONNECTION_CLOSED;
+  connection->nclosed++;
+  connection->lifetime_sum += now - connection->opened;
+}
+
+int connection_accept(connection_t *connection, int AorB, const pkt_t *syn)
+{
+  if (connection->peer_state != CONNECTION_LISTEN && syn->seqnum == connection->peer_isn)
+    return 0;
+  connection->peer_state = CONNECTION_SYN_RECEIVED;
+  connection->peer_isn = syn->seqnum;
+  connection->reply_isn = isn(AorB + 2, syn->flowid, connection->naccepted++);
+  connection->first_byte = 0;
+  return 1;
+}
+
+void connection_confirm(connection_t *connection, const pkt_t *packet)
+{
+  if (connection->peer_state == CONNECTION_SYN_RECEIVED &&
+      (packet->acknum != CONNECTION_ACK || packet->seqnum == connection->peer_isn + 1))
+    connection->peer_state = CONNECTION_ESTABLISHED;
+}
+
+void connection_delivered(connection_t *connection, double now)
+{
+  if (connection->first_byte == 0)
+    connection->first_byte = now;
+}
+
+void connection_mark(const connection_t *connection, pkt_t *ack, char mark)
+{
+  if (mark == CONNECTION_SYN_ACK)
+    ack->seqnum = connection->reply_isn;
+  if (mark != 0)
+    ack->payload[11] = mark;
+  memcpy(ack->payload + 12, &connection->first_byte, sizeof(double));
+  ack->checksum = get_checksum(ack);
+}
+
+void connection_add(connection_stats_t *stats, const connection_t *connection)
+{
+  stats->nopened += connection->nopened;
+  stats->nclosed += connection->nclosed;
+  stats->nsyn += connection->nsyn;
+  stats->nfin += connection->nfin;
+  stats->nttfb += connection->nttfb;
+  stats->ttfb_sum += connection->ttfb_sum;
+  stats->lifetime_sum += connection->lifetime_sum;
+}
+
+void connection_print(const connection_stats_t *stats)
+{
+  printf("handshake: %d connections opened, %d closed, %d SYNs and %d FINs sent again; "
+         "%.3f time to first byte and %.3f lifetime on average\n",
+         stats->nopened, stats->nclosed, stats->nsyn, stats->nfin,
+         stats->nttfb > 0 ? stats->ttfb_sum / stats->nttfb : 0.0,
+         stats->nclosed > 0 ? stats->lifetime_sum / stats->nclosed : 0.0);
+}
@@ -0,0 +1,125 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+#include "emulator.h"
+
+/* ******************************************************************
+ CONNECTION SETUP AND TEARDOWN
+
+   Shared by the alternating bit and go-back-n protocols when
+   handshake_mode() is not HANDSHAKE_NONE.  The data each entity sends
+   on a flow goes over a connection of its own, which the sender opens
+   when it is given a message with none open, and closes once all it
+   was given is ACKed:
+
+     sender                       receiver
+     SYN (seqnum ISN) ----------> replies SYN-ACK, expects ISN + 1
+     <---------- SYN-ACK (an ACK, seqnum the ISN of the receiver)
+     ACK (its ISN + 1) ---------> the handshake is complete
+     data ... FIN (seqnum after the data) --->
+     <---------- FIN-ACK (an ACK, acknum the FIN + 1)
+
+   With HANDSHAKE_FASTOPEN the SYN carries the first message, which
+   the receiver gives layer 5 at once.  The sender resends the SYN and
+   the FIN on its retransmission timer, which go-back-n doubles on each
+   of them up to its RTO_MAX; a receiver that does not know the
+   connection of a data packet drops it, and ACKs any FIN.  Initial
+   sequence numbers are drawn from a hash of the entity, the flow and
+   the number of connections it opened, so they do not depend on the
+   random numbers of the run or on the partitions of the parallel
+   engine.
+
+   Control packets are told apart by a negative acknum (a data packet
+   carries a sequence number there), SYN-ACKs and FIN-ACKs by a mark in
+   payload[11] of the ACK.  Every ACK of a connection whose data
+   reached layer 5 carries in payload[12..19] the time the first of it
+   did, from which the sender takes the time to first byte.
+**********************************************************************/
+
+/* acknum of the control packets */
+#define CONNECTION_SYN -2
+#define CONNECTION_SYN_DATA -3 /* a SYN with the first message as payload */
+#define CONNECTION_ACK -4      /* ACKs the SYN-ACK, seqnum the ISN + 1 */
+#define CONNECTION_FIN -5
+#define CONNECTION_CONTROL(acknum) ((acknum) <= CONNECTION_SYN && (acknum) >= CONNECTION_FIN)
+
+/* the mark of an ACK, in payload[11] */
+#define CONNECTION_SYN_ACK 'S'
+#define CONNECTION_FIN_ACK 'F'
+
+/* state of the connection of the data an entity sends */
+#define CONNECTION_CLOSED 0
+#define CONNECTION_SYN_SENT 1
+#define CONNECTION_ESTABLISHED 2
+#define CONNECTION_FIN_SENT 3
+
+/* state of the connection of the data it receives */
+#define CONNECTION_LISTEN 0
+#define CONNECTION_SYN_RECEIVED 1
+/* then CONNECTION_ESTABLISHED */
+
+typedef struct connection_s
+{
+  int state;           /* CONNECTION_ of the data sent */
+  int isn;             /* of the connection open or opening */
+  double opened;       /* when it was */
+  int first_byte_seen; /* its time to first byte has been counted */
+  int fin_seqnum;      /* of the FIN sent */
+
+  int peer_state;      /* CONNECTION_ of the data received */
+  int peer_isn;        /* ISN of its SYN */
+  int reply_isn;       /* seqnum of the SYN-ACK that answered it */
+  double first_byte;   /* when layer 5 got its first data, 0 before */
+
+  int nopened;         /* connections opened */
+  int naccepted;       /* SYNs of new connections received */
+  int nclosed;         /* connections opened and closed */
+  int nsyn;            /* SYNs and FINs sent again on timeouts */
+  int nfin;
+  int nttfb;           /* connections whose time to first byte is known */
+  double ttfb_sum;
+  double lifetime_sum; /* of those closed, from the SYN to the FIN-ACK */
+} connection_t;
+
+/* sets up the connections of an entity.  Without a handshake the */
+/* data it sends and receives are always on an established one.   */
+void connection_init(connection_t *connection, int mode);
+
+/* the sender of entity AorB opens a new connection at time now */
+void connection_open(connection_t *connection, int AorB, int flowid, double now);
+/* fills packet with its SYN, carrying data if it is not NULL */
+void connection_syn(const connection_t *connection, pkt_t *packet, int flowid, const char *data);
+/* the SYN-ACK syn_ack came back: fills packet with the ACK of it */
+void connection_established(connection_t *connection, const pkt_t *syn_ack, pkt_t *packet);
+/* counts the time to first byte an ACK carries, if it is the first of */
+/* the connection open                                                 */
+void connection_acked(connection_t *connection, const pkt_t *ack);
+/* fills packet with the FIN closing the connection after seqnum */
+void connection_fin(connection_t *connection, pkt_t *packet, int flowid, int seqnum);
+/* returns whether ack is the FIN-ACK of the FIN sent */
+int connection_fin_acked(const connection_t *connection, const pkt_t *ack);
+/* the FIN-ACK came back at time now */
+void connection_close(connection_t *connection, double now);
+
+/* the receiver of entity AorB got the SYN syn: returns 1 if it opens */
+/* a new connection, 0 if it was sent again                          */
+int connection_accept(connection_t *connection, int AorB, const pkt_t *syn);
+/* packet, the ACK of the SYN-ACK or data, confirms the connection */
+void connection_confirm(connection_t *connection, const pkt_t *packet);
+/* layer 5 got data at time now */
+void connection_delivered(connection_t *connection, double now);
+/* marks an ACK the receiver built with mark, 0 for none, and with the */
+/* time to first byte, and sets its checksum again.  A SYN-ACK gets     */
+/* the ISN of the receiver.                                             */
+void connection_mark(const connection_t *connection, pkt_t *ack, char mark);
+
+/* totals of the connections of a protocol */
+typedef struct connection_stats_s
+{
+  int nopened, nclosed, nsyn, nfin, nttfb;
+  double ttfb_sum, lifetime_sum;
+} connection_stats_t;
+
+void connection_add(connection_stats_t *stats, const connection_t *connection);
+void connection_print(const connection_stats_t *stats);
+
+#endif
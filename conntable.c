@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include "conntable.h"
+
+#define MIN_CAPACITY 16
+
+static unsigned int hash(int key)
+{
+  unsigned int h = (unsigned int)key;
+  h ^= h >> 16;
+  h *= 0x45d9f3b;
+  h ^= h >> 16;
+  return h;
+}
+
+void conn_table_init(conn_table_t *table)
+{
+  table->keys = NULL;
+  table->values = NULL;
+  table->capacity = 0;
+  table->count = 0;
+}
+
+void *conn_table_get(conn_table_t *table, int key)
+{
+  unsigned int i;
+
+  if (table->capacity == 0)
+    return NULL;
+  for (i = hash(key) & (table->capacity - 1); table->keys[i] != -1;
+       i = (i + 1) & (table->capacity - 1))
+    if (table->keys[i] == key)
+      return table->values[i];
+  return NULL;
+}
+
+static void grow(conn_table_t *table)
+{
+  conn_table_t old = *table;
+  int i;
+
+  table->capacity = old.capacity == 0 ? MIN_CAPACITY : old.capacity * 2;
+  table->keys = (int *)malloc(table->capacity * sizeof(int));
+  table->values = (void **)malloc(table->capacity * sizeof(void *));
+  table->count = 0;
+  for (i = 0; i < table->capacity; i++)
+    table->keys[i] = -1;
+  for (i = 0; i < old.capacity; i++)
+    if (old.keys[i] != -1)
+      conn_table_put(table, old.keys[i], old.values[i]);
+  free(old.keys);
+  free(old.values);
+}
+
+void conn_table_put(conn_table_t *table, int key, void *value)
+{
+  unsigned int i;
+
+  /* keep the load factor under one half */
+  if (2 * (table->count + 1) > table->capacity)
+    grow(table);
+  for (i = hash(key) & (table->capacity - 1); table->keys[i] != -1;
+       i = (i + 1) & (table->capacity - 1))
+    if (table->keys[i] == key)
+    {
+      table->values[i] = value;
+      return;
+    }
+  table->keys[i] = key;
+  table->values[i] = value;
+  table->count++;
+}
+
+void conn_table_clear(conn_table_t *table, void (*destroy)(void *))
+{
+  int i;
+
+  if (destroy != NULL)
+    for (i = 0; i < table->capacity; i++)
+      if (table->keys[i] != -1 && table->values[i] != NULL)
+        destroy(table->values[i]);
+  free(table->keys);
+  free(table->values);
+  conn_table_init(table);
+}
+
+size_t conn_table_bytes(conn_table_t *table)
+{
+  return table->capacity * (sizeof(int) + sizeof(void *));
+}
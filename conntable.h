@@ -0,0 +1,23 @@
+#ifndef CONNTABLE_H
+#define CONNTABLE_H
+#include <stddef.h>
+
+/* open addressing hash table from a non-negative flow key to a pointer, */
+/* used for the per-flow connection state of the protocols and the      */
+/* per-flow timers of the emulator                                      */
+typedef struct conn_table_s
+{
+  int *keys;     /* -1 for an empty slot */
+  void **values;
+  int capacity;  /* power of two, or 0 before the first put */
+  int count;
+} conn_table_t;
+
+void conn_table_init(conn_table_t *table);
+void *conn_table_get(conn_table_t *table, int key);
+void conn_table_put(conn_table_t *table, int key, void *value);
+/* calls destroy (if not NULL) on every value, then empties the table */
+void conn_table_clear(conn_table_t *table, void (*destroy)(void *));
+size_t conn_table_bytes(conn_table_t *table);
+
+#endif
@@ -0,0 +1,1153 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "arrival.h"
+#include "backend.h"
+#include "conntable.h"
+#include "emulator.h"
+#include "link.h"
+#include "loss.h"
+#include "pcap.h"
+#include "profile.h"
+#include "record.h"
+#include "sampler.h"
+#include "topology.h"
+/*****************************************************************
+***************** NETWORK EMULATION CODE STARTS BELOW ***********
+The code below emulates the layer 3 and below network environment:
+  - emulates the tranmission and delivery (possibly with bit-level corruption
+    and packet loss) of packets across the layer 3/4 interface
+  - handles the starting/stopping of a timer, and generates timer
+    interrupts (resulting in calling students timer handler).
+  - generates message to be sent (passed from later 5 to 4)
+
+THERE IS NOT REASON THAT ANY STUDENT SHOULD HAVE TO READ OR UNDERSTAND
+THE CODE BELOW.  YOU SHOLD NOT TOUCH, OR REFERENCE (in your code) ANY
+OF THE DATA STRUCTURES BELOW.  If you're interested in how I designed
+the emulator, you're welcome to look at the code - but again, you should have
+to, and you defeinitely should not have to modify
+******************************************************************/
+
+typedef struct event
+{
+  double evtime;      /* event time */
+  int evtype;         /* event type code */
+  int eventity;       /* entity where event occurs */
+  int flowid;         /* flow of the entity the event is for */
+  struct pkt *pktptr; /* ptr to packet (if any) assoc w/ this event */
+  int corrupted;      /* packet corrupted by the medium */
+  int hop;            /* node a FORWARD packet arrives at */
+  long evseq;         /* insertion order, breaks ties between equal evtimes */
+  int heapidx;        /* position of the event in evlist */
+} event_t;
+
+/* the event list, a binary heap ordered by evtime.  Among events with */
+/* the same evtime the most recently inserted one comes first.          */
+static event_t **evlist = NULL;
+static int nevlist = 0;    /* events in evlist */
+static int evlistsize = 0; /* allocated slots in evlist */
+static long nextevseq = 0;
+
+static conn_table_t timers; /* running timer event, by TIMER_KEY */
+static double lastarrival[2]; /* latest arrival time of packets in the */
+                              /* medium on their way to each entity     */
+static loss_model_t loss;    /* decides which packets the medium loses */
+static bit_errors_t bit_errors[2]; /* of the medium from each entity */
+static link_t links[2];       /* bottleneck link from each entity, used */
+                              /* instead of lastarrival if bandwidth > 0 */
+static arrival_t arrivals[2]; /* of the messages from each entity */
+static double burst_time[2];  /* when each entity sent its last packets */
+static int burst[2];          /* packets it sent then, 0 before the first */
+static int per_direction;     /* arrivals of each entity drawn on their own, */
+                              /* instead of the original single stream       */
+
+// Function definition
+static void insertevent(event_t *p);
+static void removeevent(event_t *p);
+static event_t *popevent();
+static void free_event(event_t *p);
+static void generate_next_arrival(int AorB);
+static void schedule_arrival(int AorB, int flowid, double evtime);
+static void flow_given(int AorB, int flowid);
+static void flow_timeout(int AorB, int flowid);
+static int forward(event_t *evptr, int node);
+static void send_routed(int AorB, pkt_t *packet);
+static void init(const emulator_params_t *params);
+
+/* possible events: */
+#define TIMER_INTERRUPT 0
+#define FROM_LAYER5 1
+#define FROM_LAYER3 2
+#define FORWARD 3 /* a packet arrives at a router of the topology */
+
+#define OFF 0
+#define ON 1
+
+#define TIMER_KEY(AorB, flowid) ((flowid) * 2 + (AorB))
+
+static int nsim = 0;    /* number of messages from 5 to 4 so far */
+static int nsimmax = 0; /* number of msgs to generate, then stop */
+static double time = 0.000;
+static float corruptprob; /* probability that one bit is packet is flipped */
+static float ber;         /* bit error rate, replaces corruptprob if > 0 */
+static const protocol_t *protocol;
+static float lambda;      /* arrival rate of messages from layer 5 */
+static int bidirectional; /* generate messages at B as well as A */
+static int nflows;        /* flows messages are spread over */
+static float bandwidth;   /* link rate, 0 for random delays */
+static float propdelay;   /* propagation delay of the link */
+static emulator_stats_t *stats;
+static emulator_params_t simparams; /* of the run, changed by branch variants */
+static record_writer_t recording;   /* if simparams.record is set */
+static int replaying;               /* inputs come from a record log */
+static sampler_t sampler;           /* if simparams.samples is set */
+static pcap_writer_t capture;       /* if simparams.pcap is set */
+static long nmedium;                /* FROM_LAYER3 events in evlist */
+static int rcvbuf;                  /* receive buffer of a flow, 0 for no limit */
+static float read_rate;             /* of layer 5 from the receive buffer */
+static double *read_until;          /* by TIMER_KEY, when layer 5 will have */
+                                    /* read the receive buffer, if rcvbuf > 0 */
+static flow_stats_t *flows;         /* by TIMER_KEY of the sender, if drain */
+static int nflow_stats;
+static profile_t profile;           /* if simparams.profile is set */
+static int profiling;               /* while a profiled run simulates */
+static int profiled;                /* whether the last run was */
+static topology_t topology;         /* if simparams.topology is set */
+
+/* makes call, timed as routine if the run is profiled */
+#define PROFILED(routine, call)               \
+  do                                          \
+  {                                           \
+    if (profiling)                            \
+      profile_enter(&profile);                \
+    call;                                     \
+    if (profiling)                            \
+      profile_leave(&profile, (routine));     \
+  } while (0)
+
+static void take_sample()
+{
+  protocol_sample_t totals = {0};
+  sample_t sample;
+
+  if (protocol->sample != NULL)
+    protocol->sample(&totals);
+  sample.time = sampler.next;
+  sample.in_transit = totals.in_transit;
+  sample.window = totals.window;
+  sample.bytes_delivered = stats->bytes_delivered;
+  sample.retransmissions = totals.retransmissions;
+  sample.pending_events = nevlist;
+  sample.in_medium = nmedium;
+  sampler_write(&sampler, &sample);
+}
+
+static void record(int type, event_t *event, int n)
+{
+  record_entry_t entry;
+
+  entry.time = time;
+  entry.type = type;
+  entry.entity = event->eventity;
+  entry.flowid = event->flowid;
+  entry.n = n;
+  if (type == RECORD_INPUT)
+    entry.packet = *event->pktptr;
+  record_write(&recording, &entry);
+}
+
+/* forks the variants of branch, returns the variant this process is */
+static int fork_variants(emulator_branch_t *branch)
+{
+  pid_t *children = (pid_t *)malloc(branch->nvariants * sizeof(pid_t));
+  int i, n = 0;
+
+  branch->branched = 1;
+  branch->at_branch = *stats;
+  branch->at_branch.time = branch->time;
+  branch->at_branch.nsim = nsim;
+  fflush(stdout); /* or the children would print it again */
+  for (i = 1; i <= branch->nvariants; i++)
+  {
+    if ((children[n] = fork()) == 0)
+      break;
+    if (children[n] < 0)
+    {
+      perror("fork");
+      break;
+    }
+    n++;
+  }
+  if (i > branch->nvariants || children[n] != 0)
+  {
+    for (i = 0; i < n; i++)
+      waitpid(children[i], NULL, 0);
+    i = 0;
+  }
+  free(children);
+
+  if (branch->vary != NULL)
+    branch->vary(i, &simparams, branch->arg);
+  nsimmax = simparams.nsimmax;
+  corruptprob = simparams.corruptprob;
+  lambda = simparams.lambda;
+  arrivals[A].lambda = arrivals[B].lambda = lambda;
+  return i;
+}
+
+int emulator_run(const protocol_t *run_protocol, const emulator_params_t *params,
+                 emulator_stats_t *run_stats)
+{
+  return emulator_run_branch(run_protocol, params, NULL, run_stats);
+}
+
+int emulator_run_branch(const protocol_t *run_protocol, const emulator_params_t *params,
+                        emulator_branch_t *branch, emulator_stats_t *run_stats)
+{
+  event_t *eventptr;
+  struct msg msg2give;
+  struct pkt pkt2give;
+  int variant = 0, status = 0;
+
+  protocol = run_protocol;
+  stats = run_stats;
+  *stats = (emulator_stats_t){0}; /* for the log trailer of a run that fails */
+  simparams = *params;
+  if (branch != NULL && (params->record != NULL || params->samples != NULL || params->pcap != NULL))
+  {
+    fprintf(stderr, "emulator_run_branch: a run that branches can not be recorded, sampled "
+                    "or captured\n");
+    return -1;
+  }
+  if (params->record != NULL && params->rcvbuf > 0)
+  {
+    fprintf(stderr, "emulator_run: a run with a receive buffer can not be recorded\n");
+    return -1;
+  }
+  if (params->record != NULL && params->fec_group > 0)
+  {
+    fprintf(stderr, "emulator_run: a run with forward error correction can not be recorded\n");
+    return -1;
+  }
+  if (params->record != NULL && params->handshake != HANDSHAKE_NONE)
+  {
+    fprintf(stderr, "emulator_run: a run with a handshake can not be recorded\n");
+    return -1;
+  }
+  if (params->record != NULL && (params->window > 0 || params->timeout > 0))
+  {
+    fprintf(stderr, "emulator_run: a run with its own window or timeout can not be recorded\n");
+    return -1;
+  }
+  if (loss_open(&loss, &simparams) < 0)
+    return -1;
+  if (arrival_open(&arrivals[A], &simparams, A) < 0 ||
+      arrival_open(&arrivals[B], &simparams, B) < 0)
+  {
+    arrival_close(&arrivals[A]);
+    loss_close(&loss);
+    return -1;
+  }
+  if (params->samples != NULL &&
+      sampler_open(&sampler, params->samples, params->sample_interval) < 0)
+  {
+    arrival_close(&arrivals[A]);
+    arrival_close(&arrivals[B]);
+    loss_close(&loss);
+    return -1;
+  }
+  if (params->record != NULL && record_create(&recording, params->record, protocol->name) < 0)
+  {
+    arrival_close(&arrivals[A]);
+    arrival_close(&arrivals[B]);
+    loss_close(&loss);
+    if (params->samples != NULL)
+      sampler_close(&sampler);
+    return -1;
+  }
+  if (params->pcap != NULL && pcap_open(&capture, params->pcap) < 0)
+  {
+    arrival_close(&arrivals[A]);
+    arrival_close(&arrivals[B]);
+    loss_close(&loss);
+    if (params->samples != NULL)
+      sampler_close(&sampler);
+    if (params->record != NULL)
+      record_finish(&recording, stats);
+    return -1;
+  }
+  topology_close(&topology); /* of the previous run */
+  if (params->topology != NULL && topology_open(&topology, &simparams) < 0)
+  {
+    arrival_close(&arrivals[A]);
+    arrival_close(&arrivals[B]);
+    loss_close(&loss);
+    if (params->samples != NULL)
+      sampler_close(&sampler);
+    if (params->record != NULL)
+      record_finish(&recording, stats);
+    if (params->pcap != NULL)
+      pcap_close(&capture);
+    return -1;
+  }
+  protocol->init(A); /* closes the flows of a previous run */
+  protocol->init(B);
+  memory_reset();
+  init(&simparams);
+  if (branch != NULL)
+    branch->branched = 0;
+  profiled = profiling = simparams.profile;
+  if (profiling)
+    profile_start(&profile);
+
+  while (1)
+  {
+    PROFILED(PROFILE_POPEVENT, eventptr = popevent()); /* get next event to simulate */
+    if (eventptr == NULL)
+      goto terminate;
+    if (TRACE >= 2)
+    {
+      printf("\nEVENT time: %f,", eventptr->evtime);
+      printf("  type: %d", eventptr->evtype);
+      if (eventptr->evtype == 0)
+        printf(", timerinterrupt  ");
+      else if (eventptr->evtype == 1)
+        printf(", fromlayer5 ");
+      else if (eventptr->evtype == 2)
+        printf(", fromlayer3 ");
+      else
+        printf(", forward at %s ", topology.names[eventptr->hop]);
+      printf(" entity: %c", eventptr->eventity == A ? 'A' : 'B');
+      if (nflows > 1)
+        printf(" flow: %d", eventptr->flowid);
+      printf("\n");
+    }
+    if (branch != NULL && !branch->branched && eventptr->evtime >= branch->time)
+      variant = fork_variants(branch);
+    while (simparams.samples != NULL && eventptr->evtime >= sampler.next)
+      take_sample();
+    time = eventptr->evtime; /* update time to next event time */
+    if (nsim == nsimmax && !simparams.drain)
+    {
+      /* all done with simulation */
+      free_event(eventptr);
+      break;
+    }
+    if (nsim == nsimmax && simparams.drain_limit > 0 &&
+        time > stats->drain_start + simparams.drain_limit)
+    {
+      /* the flows that did not complete stay so in emulator_flows() */
+      stats->drain_stopped = 1;
+      free_event(eventptr);
+      break;
+    }
+    if (nsim == nsimmax && eventptr->evtype == FROM_LAYER5)
+    {
+      /* draining: no more messages, the run ends when the list empties */
+      free_event(eventptr);
+      continue;
+    }
+    stats->nevents++;
+    if (profiling)
+      profile_event(&profile, eventptr->evtype, nevlist + 1);
+    if (eventptr->evtype == FROM_LAYER5)
+    {
+      /* set up future arrival */
+      PROFILED(PROFILE_ARRIVAL, generate_next_arrival(eventptr->eventity));
+      layer5_message(&msg2give, nsim, time);
+      if (simparams.record != NULL)
+        record(RECORD_OUTPUT, eventptr, nsim);
+      if (flows != NULL)
+        flow_given(eventptr->eventity, eventptr->flowid);
+      if (++nsim == nsimmax)
+        stats->drain_start = time;
+      PROFILED(PROFILE_OUTPUT + eventptr->eventity,
+               protocol->output(eventptr->eventity, eventptr->flowid, msg2give));
+    }
+    else if (eventptr->evtype == FROM_LAYER3)
+    {
+      pkt2give = *eventptr->pktptr;
+      nmedium--;
+      if (simparams.record != NULL)
+        record(RECORD_INPUT, eventptr, 0);
+      if (simparams.pcap != NULL)
+        pcap_write(&capture, time, eventptr->eventity, 0, eventptr->pktptr,
+                   eventptr->corrupted ? PCAP_CORRUPTED : NULL);
+      /* deliver packet by calling appropriate entity */
+      PROFILED(PROFILE_INPUT + eventptr->eventity, protocol->input(eventptr->eventity, pkt2give));
+    }
+    else if (eventptr->evtype == TIMER_INTERRUPT)
+    {
+      conn_table_put(&timers, TIMER_KEY(eventptr->eventity, eventptr->flowid), NULL);
+      if (flows != NULL)
+        flow_timeout(eventptr->eventity, eventptr->flowid);
+      if (simparams.record != NULL)
+        record(RECORD_TIMER, eventptr, 0);
+      PROFILED(PROFILE_TIMER + eventptr->eventity,
+               protocol->timerinterrupt(eventptr->eventity, eventptr->flowid));
+    }
+    else if (eventptr->evtype == FORWARD)
+    {
+      forward(eventptr, eventptr->hop); /* sends the event on, or frees it */
+      continue;
+    }
+    else
+    {
+      printf("INTERNAL PANIC: unknown event type \n");
+    }
+    free_event(eventptr);
+  }
+
+terminate:
+  if (profiling)
+    profile_stop(&profile);
+  profiling = 0;
+  memory_get(stats->memory, &stats->peak_memory);
+  /* release the events still pending when the simulation stopped */
+  while ((eventptr = popevent()) != NULL)
+    free_event(eventptr);
+  stats->timer_bytes = conn_table_bytes(&timers);
+  conn_table_clear(&timers, NULL);
+  free(read_until);
+  read_until = NULL;
+  if (bandwidth > 0)
+  {
+    link_close(&links[A], time);
+    link_close(&links[B], time);
+  }
+  if (topology.nnodes > 0)
+    topology_finish(&topology, time);
+  stats->time = time;
+  stats->nsim = nsim;
+  loss_close(&loss);
+  arrival_close(&arrivals[A]);
+  arrival_close(&arrivals[B]);
+  if (simparams.record != NULL && record_finish(&recording, stats) < 0)
+    status = -1;
+  if (simparams.samples != NULL && sampler_close(&sampler) < 0)
+    status = -1;
+  if (simparams.pcap != NULL && pcap_close(&capture) < 0)
+    status = -1;
+  if (TRACE > 0)
+    printf(" Simulator terminated at time %f\n after sending %d msgs from layer5\n", time, nsim);
+  return status < 0 ? status : variant;
+}
+
+int emulator_replay(const protocol_t *run_protocol, const char *path,
+                    emulator_stats_t *run_stats, emulator_stats_t *recorded)
+{
+  record_reader_t reader;
+  record_entry_t entry;
+  msg_t msg2give;
+  int status;
+
+  if (record_open(&reader, path) < 0)
+    return -1;
+  if (strcmp(reader.protocol, run_protocol->name) != 0)
+  {
+    fprintf(stderr, "%s: recorded with %s, not %s\n", path, reader.protocol,
+            run_protocol->name);
+    record_close(&reader);
+    return -1;
+  }
+
+  protocol = run_protocol;
+  stats = run_stats;
+  *stats = (emulator_stats_t){0};
+  burst[A] = burst[B] = 0;
+  nsim = 0;
+  time = 0.0;
+  rcvbuf = 0;
+  simparams.fec_group = 0;
+  simparams.handshake = HANDSHAKE_NONE;
+  simparams.window = 0;
+  simparams.timeout = 0;
+  free(flows);
+  flows = NULL;
+  profiled = 0;
+  replaying = 1;
+  layer5_reset();
+  protocol->init(A);
+  protocol->init(B);
+  memory_reset();
+  while ((status = record_next(&reader, &entry)) == 1)
+  {
+    time = entry.time;
+    stats->nevents++;
+    if (entry.type == RECORD_OUTPUT)
+    {
+      layer5_message(&msg2give, entry.n, time);
+      nsim++;
+      protocol->output(entry.entity, entry.flowid, msg2give);
+    }
+    else if (entry.type == RECORD_INPUT)
+      protocol->input(entry.entity, entry.packet);
+    else
+      protocol->timerinterrupt(entry.entity, entry.flowid);
+  }
+  replaying = 0;
+  if (status < 0)
+    fprintf(stderr, "%s: the log is cut short\n", path);
+
+  stats->time = time;
+  stats->nsim = nsim;
+  memory_get(stats->memory, &stats->peak_memory);
+  *recorded = reader.stats;
+  record_close(&reader);
+  return status;
+}
+
+int emulator_topology(const topology_t **run_topology)
+{
+  *run_topology = &topology;
+  return topology.nnodes > 0;
+}
+
+int emulator_profile(const profile_t **run_profile)
+{
+  *run_profile = &profile;
+  return profiled;
+}
+
+int emulator_close()
+{
+  static const char *names[MEMORY_CATEGORIES] = {"events", "channel", "window"};
+  memory_stats_t memory[MEMORY_CATEGORIES];
+  int i, status = 0;
+
+  free(flows);
+  flows = NULL;
+  nflow_stats = 0;
+  topology_close(&topology);
+  if (protocol == NULL)
+    return 0;
+  protocol->init(A);
+  protocol->init(B);
+  protocol = NULL;
+  memory_get(memory, NULL);
+  for (i = 0; i < MEMORY_CATEGORIES; i++)
+    if (memory[i].current != 0)
+    {
+      fprintf(stderr, "emulator_close: %zu bytes of %s memory not freed\n",
+              memory[i].current, names[i]);
+      status = -1;
+    }
+  return status;
+}
+
+static void init(const emulator_params_t *params) /* initialize the simulator */
+{
+  layer5_reset();
+  nsimmax = params->nsimmax;
+  corruptprob = params->corruptprob;
+  ber = params->ber;
+  lambda = params->lambda;
+  bidirectional = params->bidirectional;
+  nflows = params->nflows;
+  bandwidth = params->bandwidth;
+  propdelay = params->propdelay;
+  rcvbuf = params->rcvbuf;
+  read_rate = params->read_rate;
+  TRACE = params->trace;
+
+  init_random(params->seed);
+
+  nsim = 0;
+  *stats = (emulator_stats_t){0};
+  burst[A] = burst[B] = 0;
+  nextevseq = 0;
+  nmedium = 0;
+  conn_table_init(&timers);
+  lastarrival[A] = lastarrival[B] = 0.0;
+  if (rcvbuf > 0)
+    read_until = (double *)calloc(2 * nflows, sizeof(double));
+  free(flows);
+  flows = NULL;
+  nflow_stats = 0;
+  if (params->drain)
+  {
+    nflow_stats = 2 * nflows;
+    flows = (flow_stats_t *)calloc(nflow_stats, sizeof(flow_stats_t));
+    for (int i = 0; i < nflow_stats; i++)
+    {
+      flows[i].entity = i % 2;
+      flows[i].flowid = i / 2;
+      flows[i].recovery_start = -1;
+    }
+  }
+  if (ber > 0)
+  {
+    bit_errors_init(&bit_errors[A], ber);
+    bit_errors_init(&bit_errors[B], ber);
+  }
+  if (bandwidth > 0)
+  {
+    link_init(&links[A], params, &stats->link[A]);
+    link_init(&links[B], params, &stats->link[B]);
+  }
+
+  time = 0.0; /* initialize time to 0.0 */
+  /* initialize event list */
+  per_direction = params->arrival[A] != ARRIVAL_UNIFORM || params->arrival[B] != ARRIVAL_UNIFORM;
+  if (!per_direction)
+    generate_next_arrival(A);
+  for (int AorB = A; per_direction && AorB <= B; AorB++)
+  {
+    if (arrivals[AorB].model != ARRIVAL_BULK)
+      generate_next_arrival(AorB);
+    else
+      for (int flowid = 0; flowid < nflows; flowid++)
+        for (int i = 0; i < params->bulk_depth; i++)
+          schedule_arrival(AorB, flowid, time);
+  }
+}
+
+/********************* EVENT HANDLINE ROUTINES *******/
+/*  The next set of routines handle the event list   */
+/*****************************************************/
+
+void printevlist()
+{
+  event_t *q;
+  int i;
+  printf("--------------\nEvent List Follows:\n");
+  for (i = 0; i < nevlist; i++)
+  {
+    q = evlist[i];
+    printf("Event time: %f, type: %d entity: %d flow: %d\n", q->evtime, q->evtype,
+           q->eventity, q->flowid);
+  }
+  printf("--------------\n");
+}
+
+static void schedule_arrival(int AorB, int flowid, double evtime)
+{
+  event_t *evptr = (event_t *)memory_alloc(MEMORY_EVENTS, sizeof(event_t));
+
+  evptr->evtime = evtime;
+  evptr->evtype = FROM_LAYER5;
+  evptr->eventity = AorB;
+  if (flowid < 0 && nflows > 1)
+  {
+    flowid = jimsrand() * nflows; /* flow is uniform on [0,nflows) */
+    if (flowid >= nflows)
+      flowid = nflows - 1;
+  }
+  evptr->flowid = flowid < 0 ? 0 : flowid % nflows;
+  evptr->pktptr = NULL;
+  insertevent(evptr);
+}
+
+/* sets up the arrival after the message AorB was just given */
+static void generate_next_arrival(int AorB)
+{
+  double x;
+  event_t *evptr;
+  int flowid;
+
+  if (TRACE > 2)
+    printf("          GENERATE NEXT ARRIVAL: creating new arrival\n");
+  if (per_direction)
+  {
+    if ((x = arrival_next(&arrivals[AorB], time, &flowid)) >= 0)
+      schedule_arrival(AorB, flowid, x);
+    return;
+  }
+
+  x = lambda * jimsrand() * 2; /* x is uniform on [0,2*lambda] */
+                               /* having mean of lambda        */
+  evptr = (event_t *)memory_alloc(MEMORY_EVENTS, sizeof(event_t));
+  evptr->evtime = time + x;
+  evptr->evtype = FROM_LAYER5;
+  if (bidirectional && (jimsrand() > 0.5))
+    evptr->eventity = B;
+  else
+    evptr->eventity = A;
+  evptr->flowid = 0;
+  if (nflows > 1)
+  {
+    evptr->flowid = jimsrand() * nflows; /* flow is uniform on [0,nflows) */
+    if (evptr->flowid >= nflows)
+      evptr->flowid = nflows - 1;
+  }
+  insertevent(evptr);
+}
+
+/* returns true if event p must be simulated before event q */
+static int earlier(event_t *p, event_t *q)
+{
+  return p->evtime < q->evtime || (p->evtime == q->evtime && p->evseq > q->evseq);
+}
+
+static void placeevent(event_t *p, int i)
+{
+  evlist[i] = p;
+  p->heapidx = i;
+}
+
+static void siftup(event_t *p, int i)
+{
+  while (i > 0 && earlier(p, evlist[(i - 1) / 2]))
+  {
+    placeevent(evlist[(i - 1) / 2], i);
+    i = (i - 1) / 2;
+  }
+  placeevent(p, i);
+}
+
+static void siftdown(event_t *p, int i)
+{
+  int child;
+
+  while ((child = 2 * i + 1) < nevlist)
+  {
+    if (child + 1 < nevlist && earlier(evlist[child + 1], evlist[child]))
+      child++;
+    if (!earlier(evlist[child], p))
+      break;
+    placeevent(evlist[child], i);
+    i = child;
+  }
+  placeevent(p, i);
+}
+
+static void insertevent(event_t *p)
+{
+  if (TRACE > 2)
+  {
+    printf("            INSERTEVENT: time is %lf\n", time);
+    printf("            INSERTEVENT: future time will be %lf\n", p->evtime);
+  }
+  if (profiling)
+    profile_enter(&profile);
+  if (nevlist == evlistsize)
+  {
+    memory_add(MEMORY_EVENTS, (evlistsize == 0 ? 64 : evlistsize) * sizeof(event_t *));
+    evlistsize = evlistsize == 0 ? 64 : evlistsize * 2;
+    evlist = (event_t **)realloc(evlist, evlistsize * sizeof(event_t *));
+  }
+  p->evseq = nextevseq++;
+  siftup(p, nevlist++);
+  if (nevlist > stats->peak_events)
+    stats->peak_events = nevlist;
+  if (profiling)
+    profile_leave(&profile, PROFILE_INSERTEVENT);
+  // printevlist();
+}
+
+static void removeevent(event_t *p)
+{
+  event_t *last = evlist[--nevlist];
+
+  if (last == p)
+    return;
+  /* move the last event into the hole and restore the heap order */
+  if (p->heapidx > 0 && earlier(last, evlist[(p->heapidx - 1) / 2]))
+    siftup(last, p->heapidx);
+  else
+    siftdown(last, p->heapidx);
+}
+
+static event_t *popevent()
+{
+  event_t *p;
+
+  if (nevlist == 0)
+  {
+    memory_add(MEMORY_EVENTS, -(long)(evlistsize * sizeof(event_t *)));
+    free(evlist);
+    evlist = NULL;
+    evlistsize = 0;
+    return NULL;
+  }
+  p = evlist[0];
+  removeevent(p);
+  return p;
+}
+
+/* frees p and the packet of a FROM_LAYER3 or FORWARD event */
+static void free_event(event_t *p)
+{
+  if (p->evtype == FROM_LAYER3 || p->evtype == FORWARD)
+    memory_free(MEMORY_CHANNEL, p->pktptr, sizeof(pkt_t));
+  memory_free(MEMORY_EVENTS, p, sizeof(event_t));
+}
+
+/********************** Student-callable ROUTINES ***********************/
+
+/* the student-callable routines time these, which return early */
+static void cancel_timer(int AorB, int flowid)
+{
+  event_t *q;
+
+  if (TRACE > 2)
+    printf("          STOP TIMER: stopping timer at %f\n", time);
+  if (replaying) /* the log has the timer interrupts */
+    return;
+  q = (event_t *)conn_table_get(&timers, TIMER_KEY(AorB, flowid));
+  if (q == NULL)
+  {
+    printf("Warning: unable to cancel your timer. It wasn't running.\n");
+    return;
+  }
+  /* remove this event */
+  removeevent(q);
+  conn_table_put(&timers, TIMER_KEY(AorB, flowid), NULL);
+  memory_free(MEMORY_EVENTS, q, sizeof(event_t));
+}
+
+static void schedule_timer(int AorB, int flowid, float increment)
+{
+  event_t *evptr;
+
+  if (TRACE > 2)
+    printf("          START TIMER: starting timer at %f\n", time);
+  if (replaying)
+    return;
+  /* be nice: check to see if timer is already started, if so, then  warn */
+  if (conn_table_get(&timers, TIMER_KEY(AorB, flowid)) != NULL)
+  {
+    printf("Warning: attempt to start a timer that is already started\n");
+    return;
+  }
+
+  /* create future event for when timer goes off */
+  evptr = (event_t *)memory_alloc(MEMORY_EVENTS, sizeof(event_t));
+  evptr->evtime = time + increment;
+  evptr->evtype = TIMER_INTERRUPT;
+  evptr->eventity = AorB;
+  evptr->flowid = flowid;
+  evptr->pktptr = NULL;
+  insertevent(evptr);
+  conn_table_put(&timers, TIMER_KEY(AorB, flowid), evptr);
+}
+
+/* called by students routine to cancel a previously-started timer */
+void stoptimer(int AorB, int flowid) /* A or B is trying to stop timer */
+{
+  PROFILED(PROFILE_STOPTIMER, cancel_timer(AorB, flowid));
+}
+
+void starttimer(int AorB, int flowid, float increment) /* A or B is trying to stop timer */
+{
+  PROFILED(PROFILE_STARTTIMER, schedule_timer(AorB, flowid, increment));
+}
+
+/************************** TOLAYER3 ***************/
+/* the packets an entity sends at one instant are a burst, which the */
+/* medium queues behind each other                                   */
+static void count_burst(int AorB)
+{
+  stats->nsent[AorB]++;
+  if (burst[AorB] == 0 || time != burst_time[AorB])
+  {
+    burst_time[AorB] = time;
+    burst[AorB] = 0;
+    stats->nbursts[AorB]++;
+  }
+  if (++burst[AorB] > stats->max_burst[AorB])
+    stats->max_burst[AorB] = burst[AorB];
+}
+
+static void send_packet(int AorB, struct pkt packet)
+{
+  struct pkt *mypktptr;
+  event_t *evptr;
+  double lastime, delay;
+  int i, nbits, corrupted;
+
+  stats->ntolayer3++;
+  count_burst(AorB);
+  if (replaying) /* the log has what the medium did with it */
+    return;
+  if (topology.nnodes > 0)
+  {
+    send_routed(AorB, &packet);
+    return;
+  }
+
+  /* simulate the buffer of the link: */
+  if (bandwidth > 0 && !link_admit(&links[AorB], time, jimsrand(), &packet.ecn))
+  {
+    if (TRACE > 0)
+      printf("          TOLAYER3: packet dropped by the link buffer\n");
+    if (simparams.pcap != NULL)
+      pcap_write(&capture, time, AorB, 1, &packet, PCAP_DROPPED);
+    return;
+  }
+
+  /* simulate losses: */
+  if (loss_draw(&loss, AorB, &delay, stats))
+  {
+    stats->nlost++;
+    if (TRACE > 0)
+      printf("          TOLAYER3: packet being lost\n");
+    if (simparams.pcap != NULL)
+      pcap_write(&capture, time, AorB, 1, &packet, PCAP_LOST);
+    if (bandwidth > 0)
+      link_transmit(&links[AorB], time); /* lost on the wire, after using the link */
+    return;
+  }
+
+  /* make a copy of the packet student just gave me since he/she may decide */
+  /* to do something with the packet after we return back to him/her */
+  mypktptr = (struct pkt *)memory_alloc(MEMORY_CHANNEL, sizeof(struct pkt));
+  *mypktptr = packet;
+  if (TRACE > 2)
+  {
+    printf("          TOLAYER3: seq: %d, ack %d, check: %d ", mypktptr->seqnum,
+           mypktptr->acknum, mypktptr->checksum);
+    for (i = 0; i < 20; i++)
+      printf("%c", mypktptr->payload[i]);
+    printf("\n");
+  }
+
+  /* create future event for arrival of packet at the other side */
+  evptr = (event_t *)memory_alloc(MEMORY_EVENTS, sizeof(event_t));
+  evptr->evtype = FROM_LAYER3;      /* packet will pop out from layer3 */
+  evptr->eventity = (AorB + 1) % 2; /* event occurs at other entity */
+  evptr->flowid = packet.flowid;
+  evptr->pktptr = mypktptr;         /* save ptr to my copy of packet */
+                                    /* finally, compute the arrival time of packet at the other end.
+                                       medium can not reorder, so make sure packet arrives between 1 and 10
+                                       time units after the latest arrival time of packets
+                                       currently in the medium on their way to the destination */
+  if (bandwidth > 0)
+  {
+    evptr->evtime = link_transmit(&links[AorB], time);
+    if (delay >= 0) /* the trace delay replaces the propagation delay */
+      evptr->evtime += delay - propdelay;
+  }
+  else if (delay >= 0)
+    evptr->evtime = time + delay;
+  else
+  {
+    lastime = time;
+    if (lastarrival[evptr->eventity] > lastime)
+    {
+      stats->medium_queueing += lastarrival[evptr->eventity] - time;
+      lastime = lastarrival[evptr->eventity];
+    }
+    evptr->evtime = lastime + 1 + 9 * jimsrand();
+  }
+  /* a trace delay shorter than the previous one must not reorder */
+  if (evptr->evtime < lastarrival[evptr->eventity])
+    evptr->evtime = lastarrival[evptr->eventity];
+  lastarrival[evptr->eventity] = evptr->evtime;
+
+  /* simulate corruption: */
+  corrupted = 0;
+  if (ber > 0)
+  {
+    nbits = corrupt_bits(&bit_errors[AorB], mypktptr);
+    stats->nbit_errors += nbits;
+    corrupted = nbits > 0;
+  }
+  else if (jimsrand() < corruptprob)
+  {
+    corrupt_packet(mypktptr, jimsrand());
+    corrupted = 1;
+  }
+  if (corrupted)
+  {
+    stats->ncorrupt++;
+    if (protocol->is_corrupted != NULL && !protocol->is_corrupted(mypktptr))
+      stats->nundetected++;
+    if (TRACE > 0)
+      printf("          TOLAYER3: packet being corrupted\n");
+  }
+  evptr->corrupted = corrupted;
+  if (simparams.pcap != NULL)
+    pcap_write(&capture, time, AorB, 1, &packet, corrupted ? PCAP_CORRUPTED : NULL);
+
+  if (TRACE > 2)
+    printf("          TOLAYER3: scheduling arrival on other side\n");
+  insertevent(evptr);
+  nmedium++;
+}
+
+/* moves the packet of evptr, at node, over the next link of the      */
+/* topology to the entity of evptr, and returns the TOPOLOGY_ outcome. */
+/* Frees evptr if the packet is dropped or lost.                       */
+static int forward(event_t *evptr, int node)
+{
+  const topology_link_t *link = &topology.links[topology.route[node][evptr->eventity]];
+  int outcome, next;
+
+  outcome = topology_send(&topology, node, evptr->eventity, time, evptr->pktptr, &next,
+                          &evptr->evtime, stats);
+  if (outcome == TOPOLOGY_DROPPED || outcome == TOPOLOGY_LOST)
+  {
+    if (outcome == TOPOLOGY_LOST)
+      stats->nlost++;
+    if (TRACE > 0)
+      printf("          FORWARD: packet %s on %s->%s\n",
+             outcome == TOPOLOGY_LOST ? "lost" : "dropped by the link buffer",
+             topology.names[link->from], topology.names[link->to]);
+    nmedium--;
+    free_event(evptr);
+    return outcome;
+  }
+  if (outcome == TOPOLOGY_CORRUPTED && !evptr->corrupted)
+  {
+    evptr->corrupted = 1;
+    stats->ncorrupt++;
+    if (protocol->is_corrupted != NULL && !protocol->is_corrupted(evptr->pktptr))
+      stats->nundetected++;
+    if (TRACE > 0)
+      printf("          FORWARD: packet being corrupted on %s->%s\n",
+             topology.names[link->from], topology.names[link->to]);
+  }
+  evptr->evtype = next == evptr->eventity ? FROM_LAYER3 : FORWARD;
+  evptr->hop = next;
+  insertevent(evptr);
+  return outcome;
+}
+
+/* tolayer3() over the topology: the packet enters the first link at */
+/* the host of AorB                                                  */
+static void send_routed(int AorB, pkt_t *packet)
+{
+  static const char *comments[] = {NULL, PCAP_CORRUPTED, PCAP_DROPPED, PCAP_LOST};
+  event_t *evptr = (event_t *)memory_alloc(MEMORY_EVENTS, sizeof(event_t));
+  int outcome;
+
+  evptr->evtype = FORWARD;
+  evptr->eventity = !AorB;
+  evptr->flowid = packet->flowid;
+  evptr->pktptr = (struct pkt *)memory_alloc(MEMORY_CHANNEL, sizeof(struct pkt));
+  *evptr->pktptr = *packet;
+  evptr->corrupted = 0;
+  nmedium++;
+  outcome = forward(evptr, AorB);
+  if (simparams.pcap != NULL)
+    pcap_write(&capture, time, AorB, 1, packet, comments[outcome]);
+}
+
+void tolayer3(int AorB, struct pkt packet) /* A or B is trying to stop timer */
+{
+  PROFILED(PROFILE_TOLAYER3, send_packet(AorB, packet));
+}
+
+/* a bulk sender writes the next message of a flow once one is delivered */
+static void bulk_delivered(int AorB, int flowid)
+{
+  if (per_direction && !replaying && arrivals[!AorB].model == ARRIVAL_BULK)
+    schedule_arrival(!AorB, flowid, time);
+}
+
+static void flow_given(int AorB, int flowid)
+{
+  flow_stats_t *flow = &flows[TIMER_KEY(AorB, flowid)];
+
+  if (flow->nmsgs++ == 0)
+    flow->start = time;
+}
+
+/* a timeout starts loss recovery, new data delivered ends it */
+static void flow_timeout(int AorB, int flowid)
+{
+  flow_stats_t *flow = &flows[TIMER_KEY(AorB, flowid)];
+
+  if (flow->recovery_start < 0)
+    flow->recovery_start = time;
+}
+
+/* a message from the peer of AorB was delivered for the first time */
+static void message_delivered(int AorB, int flowid, double now)
+{
+  flow_stats_t *flow;
+
+  bulk_delivered(AorB, flowid);
+  if (flows == NULL)
+    return;
+  flow = &flows[TIMER_KEY(!AorB, flowid)];
+  flow->ndelivered++;
+  flow->completion = now;
+  if (flow->recovery_start >= 0)
+  {
+    flow->recovery += now - flow->recovery_start;
+    flow->recovery_start = -1;
+  }
+}
+
+int emulator_flows(const flow_stats_t **run_flows)
+{
+  *run_flows = flows;
+  return flows != NULL ? nflow_stats : 0;
+}
+
+double current_time()
+{
+  return time;
+}
+
+int fec_group()
+{
+  return simparams.fec_group;
+}
+
+int handshake_mode()
+{
+  return simparams.handshake;
+}
+
+int send_window()
+{
+  return simparams.window;
+}
+
+float retransmit_timeout()
+{
+  return simparams.timeout;
+}
+
+/* layer 5 reads the messages of a receive buffer one after the other, */
+/* each in 1 / read_rate, so its occupancy follows from the time it     */
+/* will have read them all and needs no events                          */
+int layer5_window(int AorB, int flowid)
+{
+  double backlog;
+
+  if (rcvbuf == 0)
+    return -1;
+  backlog = (read_until[TIMER_KEY(AorB, flowid)] - time) * read_rate;
+  if (backlog <= 0)
+    return rcvbuf;
+  return backlog >= rcvbuf ? 0 : rcvbuf - (int)ceil(backlog - 1e-9);
+}
+
+static void deliver(int AorB, int flowid, char *datasent)
+{
+  double *until;
+
+  if (rcvbuf == 0)
+  {
+    if (layer5_deliver(stats, datasent, time))
+      message_delivered(AorB, flowid, time);
+    return;
+  }
+  if (layer5_window(AorB, flowid) == 0)
+  {
+    stats->nrcvbuf_full++;
+    if (TRACE > 0)
+      printf("          TOLAYER5: receive buffer full, data dropped\n");
+    return;
+  }
+  /* delivered once layer 5 has read it */
+  until = &read_until[TIMER_KEY(AorB, flowid)];
+  if (*until < time)
+    *until = time;
+  if (read_rate > 0)
+    *until += 1 / read_rate;
+  if (layer5_deliver(stats, datasent, *until))
+    message_delivered(AorB, flowid, *until);
+}
+
+void tolayer5(int AorB, int flowid, char *datasent)
+{
+  PROFILED(PROFILE_TOLAYER5, deliver(AorB, flowid, datasent));
+}
@@ -0,0 +1,339 @@
+#ifndef EMULATOR_H
+#define EMULATOR_H
+#include <stddef.h>
+/* ******************************************************************
+ ALTERNATING BIT AND GO-BACK-N NETWORK EMULATOR: VERSION 1.1  J.F.Kurose
+
+   Interface between the network emulator (emulator.c) and the transport
+   protocols that run on top of it.  A protocol fills a protocol_t with
+   its entity callbacks; emulator_run() drives them with layer 5 arrivals,
+   layer 3 deliveries and timer interrupts.  Network properties:
+   - one way network delay averages five time units (longer if there
+     are other messages in the channel for GBN), but can be larger
+   - packets can be corrupted (either the header or the data portion)
+     or lost, according to user-defined probabilities
+   - packets will be delivered in the order in which they were sent
+     (although some can be lost).
+**********************************************************************/
+
+#define A 0
+#define B 1
+
+/* a "msg" is the data unit passed from layer 5 (teachers code) to layer  */
+/* 4 (students' code).  It contains the data (characters) to be delivered */
+/* to layer 5 via the students transport level protocol entities.         */
+typedef struct msg
+{
+  char data[20];
+} msg_t;
+
+/* a packet is the data unit passed from layer 4 (students code) to layer */
+/* 3 (teachers code).  Note the pre-defined packet structure, which all   */
+/* students must follow. */
+typedef struct pkt
+{
+  int flowid; /* connection the packet belongs to */
+  int seqnum;
+  int acknum;
+  int checksum;
+  char payload[20];
+  int ecn; /* ECN_ codepoint, like the IP header not in the checksum */
+} pkt_t;
+
+/* explicit congestion notification: a sender marks the packets of a */
+/* flow that reacts to congestion ECN_ECT, and a link whose queue     */
+/* builds up changes ECN_ECT to ECN_CE instead of dropping them       */
+#define ECN_NOT_ECT 0
+#define ECN_ECT 2
+#define ECN_CE 3
+
+/* totals over every flow of a protocol, kept as the protocol runs so */
+/* that taking them costs the same for any number of flows            */
+typedef struct protocol_sample_s
+{
+  long in_transit;      /* packets sent and not yet ACKed */
+  long window;          /* packets or messages held by the senders */
+  long retransmissions; /* packets sent again since init */
+} protocol_sample_t;
+
+/* a protocol is a set of entity routines, each called with the entity */
+/* (A or B) the event occurs at.  Every entity carries nflows flows, so */
+/* output and timerinterrupt also get the flow; input finds it in the  */
+/* packet.  init is called once per entity before any other routine.   */
+/* report, if not NULL, prints protocol statistics after a run.        */
+/* is_corrupted, if not NULL, is the receiver's corruption check; the  */
+/* emulator uses it to count corrupted packets that go undetected.     */
+/* sample, if not NULL, adds the totals of the protocol to sample.     */
+typedef struct protocol_s
+{
+  const char *name;
+  void (*init)(int AorB);
+  void (*output)(int AorB, int flowid, msg_t message);
+  void (*input)(int AorB, pkt_t packet);
+  void (*timerinterrupt)(int AorB, int flowid);
+  void (*report)(void);
+  int (*is_corrupted)(pkt_t *packet);
+  void (*sample)(protocol_sample_t *sample);
+} protocol_t;
+
+#define FEC_GROUP_MAX 32
+
+/* emulator_params_t.handshake, see connection.h */
+#define HANDSHAKE_NONE 0     /* the connections are open from the start */
+#define HANDSHAKE_OPEN 1     /* opened by a SYN, SYN-ACK and ACK, closed by a FIN */
+#define HANDSHAKE_FASTOPEN 2 /* the SYN carries the first message */
+
+/* buffer policies of the bottleneck link */
+#define QUEUE_DROPTAIL 0
+#define QUEUE_RED 1
+
+/* loss models of the medium, see loss.h */
+#define LOSS_BERNOULLI 0
+#define LOSS_GILBERT 1
+#define LOSS_TRACE 2
+
+/* arrival models of the messages from layer 5, see arrival.h */
+#define ARRIVAL_UNIFORM 0
+#define ARRIVAL_POISSON 1
+#define ARRIVAL_ONOFF 2
+#define ARRIVAL_BULK 3
+#define ARRIVAL_TRACE 4
+#define ARRIVAL_NONE 5
+
+typedef struct emulator_params_s
+{
+  int nsimmax;        /* number of msgs to generate, then stop */
+  float lossprob;     /* probability that a packet is dropped  */
+  float corruptprob;  /* probability that one bit is packet is flipped */
+  float ber;          /* bit error rate, replaces corruptprob if > 0 */
+  float lambda;       /* arrival rate of messages from layer 5 */
+  int bidirectional;  /* generate messages at B as well as A */
+  int nflows;         /* concurrent flows messages are spread over */
+  int trace;          /* trace level, see TRACE */
+  unsigned int seed;  /* random number generator seed */
+
+  /* bottleneck link of each direction, see link.h */
+  float bandwidth;    /* bytes per time unit, 0 for the random 1-10 delays */
+  float propdelay;    /* propagation delay */
+  int queue_limit;    /* packets the buffer holds, 0 for no limit */
+  int queue_policy;   /* QUEUE_DROPTAIL or QUEUE_RED */
+  float red_min;      /* average queue where RED starts dropping */
+  float red_max;      /* average queue where RED drops every packet */
+  float red_maxp;     /* RED drop probability at red_max */
+  float red_weight;   /* weight of a new sample in the RED average */
+  int ecn_threshold;  /* packets in the buffer from which ECN_ECT packets */
+                      /* are marked, 0 for no marking                     */
+
+  int loss_model;     /* LOSS_BERNOULLI (lossprob), LOSS_GILBERT or LOSS_TRACE */
+  float ge_p;         /* Gilbert-Elliott probability of going from good to bad */
+  float ge_r;         /* Gilbert-Elliott probability of going from bad to good */
+  float ge_loss_good; /* loss probability in the good state */
+  float ge_loss_bad;  /* loss probability in the bad state */
+  const char *loss_trace; /* file replayed by LOSS_TRACE */
+  const char *record;     /* log of the protocol inputs to write, see record.h */
+  const char *samples;    /* time series to write, see sampler.h */
+  float sample_interval;  /* simulation time between samples */
+  int rcvbuf;             /* messages the receive buffer of a flow holds, */
+                          /* 0 for no limit                               */
+  float read_rate;        /* messages per time unit layer 5 reads from the */
+                          /* receive buffer, 0 to read them at once        */
+  int arrival[2];         /* ARRIVAL_ model of the messages from each entity */
+  float on_time;          /* mean length of the on periods of ARRIVAL_ONOFF */
+  float off_time;         /* mean length of its off periods */
+  float pareto_shape;     /* of the on and off lengths, > 1 */
+  int bulk_depth;         /* messages ARRIVAL_BULK keeps outstanding per flow */
+  const char *arrival_trace; /* file replayed by ARRIVAL_TRACE */
+  int drain;              /* after nsimmax messages, run on until every one */
+                          /* is delivered and ACKed instead of stopping    */
+  float drain_limit;      /* if > 0, the run stops this long after the last */
+                          /* and fails if it has not drained by then       */
+  const char *pcap;       /* capture of the packets to write, see pcap.h */
+  int profile;            /* profile the simulator itself, see profile.h */
+  const char *topology;   /* hosts, routers and links replacing the medium, */
+                          /* see topology.h                                 */
+  int fec_group;          /* data packets a protocol protects with a parity */
+                          /* packet, 0 for no forward error correction,     */
+                          /* FEC_GROUP_MAX at most                          */
+  int handshake;          /* HANDSHAKE_ the protocols open and close their */
+                          /* connections with                             */
+  int window;             /* packets go-back-N keeps in transit, the most */
+                          /* of a congestion window, 0 for its default    */
+  float timeout;          /* retransmission timeout, the first of those */
+                          /* that adapt, 0 for the protocol's default   */
+} emulator_params_t;
+
+typedef struct link_stats_s
+{
+  long npackets;      /* packets admitted to the buffer */
+  long ndropped;      /* packets dropped because the buffer was full */
+  long nearly;        /* packets dropped early by RED */
+  long nmarked;       /* packets marked ECN_CE */
+  int peak_queue;     /* most packets in the buffer */
+  double queue_area;  /* integral of the buffer occupancy over time */
+  double delay_sum;   /* queueing delay of admitted packets */
+  double max_delay;   /* largest queueing delay */
+  double busy_time;   /* time spent transmitting */
+} link_stats_t;
+
+/* log-bucketed histogram of the latencies of delivered messages, see */
+/* latency.h: LATENCY_SUB_BUCKETS buckets per power of two from       */
+/* 2^LATENCY_MIN_EXP to 2^(LATENCY_MIN_EXP + LATENCY_EXPONENTS)       */
+#define LATENCY_SUB_BITS 5
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_MIN_EXP -8
+#define LATENCY_EXPONENTS 48
+#define LATENCY_BUCKETS (LATENCY_EXPONENTS * LATENCY_SUB_BUCKETS)
+
+typedef struct latency_histogram_s
+{
+  long counts[LATENCY_BUCKETS]; /* those below the range in the first, */
+                                /* those above in the last             */
+  long n;
+  double max;
+} latency_histogram_t;
+
+/* memory accounting categories, see memory_alloc() in backend.h */
+#define MEMORY_EVENTS 0     /* event list: events and the heap array */
+#define MEMORY_CHANNEL 1    /* copies of the packets in the medium */
+#define MEMORY_WINDOW 2     /* packets and messages held by the senders */
+#define MEMORY_CATEGORIES 3
+
+typedef struct memory_stats_s
+{
+  size_t current; /* bytes allocated and not freed yet */
+  size_t peak;    /* largest value of current */
+  long nallocs;
+} memory_stats_t;
+
+typedef struct emulator_stats_s
+{
+  double time;         /* simulation time at termination */
+  int nsim;            /* number of messages from 5 to 4 */
+  int ntolayer3;       /* number sent into layer 3 */
+  long nsent[2];       /* of them by each entity */
+  long nbursts[2];     /* instants at which each entity sent packets */
+  int max_burst[2];    /* most packets an entity sent at one instant */
+  int nlost;           /* number lost in media */
+  int nloss_bursts;    /* runs of consecutive losses in one direction */
+  int max_loss_burst;  /* longest of them */
+  int ncorrupt;        /* number corrupted by media */
+  long nbit_errors;    /* bits flipped by media, if ber > 0 */
+  int nundetected;     /* corrupted packets that pass protocol.is_corrupted */
+  int ndelivered;      /* distinct messages delivered to layer 5 */
+  int nrcvbuf_full;    /* messages layer 5 dropped, its receive buffer full */
+  int nduplicate;      /* messages delivered to layer 5 more than once */
+  int nunstamped;      /* not in ndelivered: delivered after their entry */
+                       /* time was evicted, see backend.c                */
+  int nbad;            /* deliveries not matching any message sent */
+  long bytes_delivered; /* data passed to layer 5, duplicates included */
+  double latency_sum;  /* sum of layer 5 to layer 5 delays of delivered msgs */
+  latency_histogram_t latency; /* of the same delays */
+  double medium_queueing; /* time packets of the random delay medium waited */
+                          /* for the arrival of those ahead of them        */
+  long nevents;        /* events taken from the event list */
+  int peak_events;     /* largest number of pending events */
+  size_t timer_bytes;  /* memory of the per-flow timer table */
+  memory_stats_t memory[MEMORY_CATEGORIES]; /* when the simulation stopped */
+  size_t peak_memory;  /* largest total of the categories */
+  double drain_start;  /* when the last message was given, if the run drained */
+  int drain_stopped;   /* the drain limit ended the run, which failed to drain */
+  link_stats_t link[2]; /* link from each entity, if bandwidth > 0 */
+} emulator_stats_t;
+
+/* a branch forks the running emulator into variants at a simulation  */
+/* time, so scenarios that share a warm-up only simulate what follows. */
+/* Each variant is a copy-on-write child process with the complete     */
+/* state of the run: event list, clock, random number generator and    */
+/* the windows of the protocol entities.                               */
+typedef struct emulator_branch_s
+{
+  double time;   /* branch before the first event at or after time */
+  int nvariants; /* children forked there, numbered 1 to nvariants */
+  /* called in variant n before it continues, and with n = 0 in the */
+  /* parent; it may change nsimmax, lossprob, corruptprob, lambda    */
+  /* and the Gilbert-Elliott model                                   */
+  void (*vary)(int n, emulator_params_t *params, void *arg);
+  void *arg;
+  emulator_stats_t at_branch; /* statistics when the run branched */
+  int branched;               /* whether the run got to time */
+} emulator_branch_t;
+
+extern int TRACE; /* for my debugging */
+
+void emulator_default_params(emulator_params_t *params);
+/* returns 0, or -1 if the loss trace can not be read or the record */
+/* log or samples can not be written                                 */
+int emulator_run(const protocol_t *protocol, const emulator_params_t *params,
+                 emulator_stats_t *stats);
+/* emulator_run() with a branch.  Like fork(), returns the number of the */
+/* variant in each child, which should exit once it is done with stats, */
+/* and 0 in the parent, which continues unchanged after the children    */
+/* have finished.  Returns -1 if the run can not be started.  A run   */
+/* that branches can not be recorded, sampled or captured.              */
+int emulator_run_branch(const protocol_t *protocol, const emulator_params_t *params,
+                        emulator_branch_t *branch, emulator_stats_t *stats);
+/* drives protocol with the inputs of a record log instead of the      */
+/* emulated network, and fills recorded with the statistics the log    */
+/* was recorded with.  Loss, corruption and event list statistics are  */
+/* not counted.  Returns 0, or -1 if the log can not be replayed.      */
+int emulator_replay(const protocol_t *protocol, const char *path, emulator_stats_t *stats,
+                    emulator_stats_t *recorded);
+/* a run frees its events before it returns, but leaves the flows of */
+/* the protocol open for protocol.report().  This closes them, then   */
+/* returns 0, or -1 after printing the categories that leaked memory. */
+int emulator_close();
+
+/* completion of a flow of a run that drains */
+typedef struct flow_stats_s
+{
+  int entity;         /* of the sender */
+  int flowid;
+  int nmsgs;          /* messages given to the sender */
+  int ndelivered;     /* of them delivered to layer 5 */
+  double start;       /* first message given */
+  double completion;  /* last message delivered */
+  double recovery;    /* from timeouts until new data was delivered */
+  double recovery_start; /* of the recovery under way, -1 if none */
+} flow_stats_t;
+
+/* sets *flows to the flows of the last run, if it drained, and returns */
+/* their number, 0 otherwise.  Flow f of entity e is (*flows)[2*f + e], */
+/* those that got no messages included.  Valid until the next run or   */
+/* emulator_close().                                                    */
+int emulator_flows(const flow_stats_t **flows);
+
+/* sets *topology to the topology of the last run, if it had one, and   */
+/* returns 1, 0 otherwise.  Its links hold their statistics.  Valid      */
+/* until the next run or emulator_close().                              */
+struct topology_s;
+int emulator_topology(const struct topology_s **topology);
+
+/* sets *profile to the profile of the last run, if it was profiled, and */
+/* returns 1, 0 otherwise.  Valid until the next run.                    */
+struct profile_s;
+int emulator_profile(const struct profile_s **profile);
+
+/********************** Student-callable ROUTINES ***********************/
+void tolayer3(int AorB, pkt_t packet);
+void tolayer5(int AorB, int flowid, char *data);
+/* free slots in the layer 5 receive buffer of flowid, to advertise to */
+/* the sender, or -1 if the buffer has no limit.  Data passed to a full */
+/* buffer is dropped.                                                   */
+int layer5_window(int AorB, int flowid);
+/* data packets per parity packet the senders add, 0 for none */
+int fec_group();
+/* HANDSHAKE_ the senders open and close their connections with */
+int handshake_mode();
+/* window and retransmission timeout of the run, 0 for the protocol's own */
+int send_window();
+float retransmit_timeout();
+void stoptimer(int AorB, int flowid);
+void starttimer(int AorB, int flowid, float increment);
+/* simulation time of the event being handled */
+double current_time();
+/* malloc() and free() accounted in a MEMORY_ category, size must be */
+/* the size the memory was allocated with                            */
+void *memory_alloc(int category, size_t size);
+void memory_free(int category, void *p, size_t size);
+
+#endif
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "emulator.h"
+#include "options.h"
+#include "protocols.h"
+
+/* runs replications of a protocol that drain to completion, one seed */
+/* each, and prints percentiles of the flow completion times and how  */
+/* much of them went to loss recovery                                 */
+
+typedef struct completion_s
+{
+  double fct;      /* flow completion time */
+  double recovery; /* of it spent in loss recovery */
+} completion_t;
+
+static int by_fct(const void *p, const void *q)
+{
+  double a = ((const completion_t *)p)->fct, b = ((const completion_t *)q)->fct;
+  return a < b ? -1 : a > b;
+}
+
+static int by_value(const void *p, const void *q)
+{
+  double a = *(const double *)p, b = *(const double *)q;
+  return a < b ? -1 : a > b;
+}
+
+/* nearest rank percentile of n sorted values */
+static int rank(int n, double percentile)
+{
+  int i = (int)(percentile / 100 * n + 0.999999) - 1;
+  return i < 0 ? 0 : i >= n ? n - 1 : i;
+}
+
+static void print_stopped(int nstopped, int nruns, double limit)
+{
+  if (nstopped > 0)
+    printf("DRAIN FAILED: %d of the %d runs not drained at the limit of %g\n", nstopped, nruns,
+           limit);
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-p protocol] [-r replications] [options]\n", prog);
+  fprintf(stderr, "  -p name     protocol to run:");
+  for (int i = 0; protocols[i] != NULL; i++)
+    fprintf(stderr, " %s", protocols[i]->name);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  -r runs     replications, with seeds counting up from -s\n");
+  emulator_usage(stderr);
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  const protocol_t *protocol = &goback_n_protocol;
+  emulator_params_t params;
+  emulator_stats_t stats;
+  const flow_stats_t *flows;
+  completion_t *completions = NULL;
+  double *runs, *tails, flow_time = 0, recovery = 0, tail_time = 0, tail_recovery = 0;
+  int opt, nruns = 20, ncompletions = 0, nincomplete = 0, nstopped = 0, nflows, i, run, tail;
+  unsigned int seed;
+
+  emulator_default_params(&params);
+  params.nsimmax = 1000;
+  params.nflows = 10;
+  params.lossprob = 0.02;
+  params.corruptprob = 0.02;
+  params.lambda = 40;
+  params.trace = 0;
+  while ((opt = getopt(argc, argv, "p:r:" EMULATOR_OPTIONS)) != -1)
+  {
+    if (opt == 'p')
+    {
+      if ((protocol = find_protocol(optarg)) == NULL)
+        usage(argv[0]);
+    }
+    else if (opt == 'r')
+    {
+      if ((nruns = atoi(optarg)) <= 0)
+        usage(argv[0]);
+    }
+    else if (emulator_option(opt, optarg, &params) != 1)
+      usage(argv[0]);
+  }
+  params.drain = 1;
+  seed = params.seed;
+
+  printf("%s, %d replications of %d msgs over %d flows, loss %.3f, corrupt %.3f, "
+         "lambda %.2f\n\n", protocol->name, nruns, params.nsimmax, params.nflows,
+         params.lossprob, params.corruptprob, params.lambda);
+  runs = (double *)malloc(nruns * sizeof(double));
+  tails = (double *)malloc(nruns * sizeof(double));
+  for (run = 0; run < nruns; run++)
+  {
+    params.seed = seed + run;
+    if (emulator_run(protocol, &params, &stats) < 0)
+      return 1;
+    runs[run] = stats.time;
+    nstopped += stats.drain_stopped;
+    tails[run] = stats.time - stats.drain_start;
+    nflows = emulator_flows(&flows);
+    completions = (completion_t *)realloc(completions,
+                                          (ncompletions + nflows) * sizeof(completion_t));
+    for (i = 0; i < nflows; i++)
+    {
+      if (flows[i].nmsgs == 0)
+        continue;
+      if (flows[i].ndelivered < flows[i].nmsgs)
+      {
+        nincomplete++;
+        continue;
+      }
+      completions[ncompletions].fct = flows[i].completion - flows[i].start;
+      completions[ncompletions].recovery = flows[i].recovery;
+      ncompletions++;
+    }
+  }
+  if (ncompletions == 0)
+  {
+    printf("no flow completed\n");
+    print_stopped(nstopped, nruns, params.drain_limit);
+    return 1;
+  }
+
+  qsort(completions, ncompletions, sizeof(completion_t), by_fct);
+  qsort(runs, nruns, sizeof(double), by_value);
+  qsort(tails, nruns, sizeof(double), by_value);
+  tail = rank(ncompletions, 99);
+  for (i = 0; i < ncompletions; i++)
+  {
+    flow_time += completions[i].fct;
+    recovery += completions[i].recovery;
+    if (i >= tail)
+    {
+      tail_time += completions[i].fct;
+      tail_recovery += completions[i].recovery;
+    }
+  }
+
+  printf("%-22s %11s %11s %11s %11s %11s\n", "", "p50", "p90", "p99", "p99.9", "max");
+  printf("%-22s %11.1f %11.1f %11.1f %11.1f %11.1f\n", "flow completion time",
+         completions[rank(ncompletions, 50)].fct, completions[rank(ncompletions, 90)].fct,
+         completions[tail].fct, completions[rank(ncompletions, 99.9)].fct,
+         completions[ncompletions - 1].fct);
+  printf("%-22s %11.1f %11.1f %11.1f %11.1f %11.1f\n", "run completion time",
+         runs[rank(nruns, 50)], runs[rank(nruns, 90)], runs[rank(nruns, 99)],
+         runs[rank(nruns, 99.9)], runs[nruns - 1]);
+  printf("%-22s %11.1f %11.1f %11.1f %11.1f %11.1f\n", "drain after last msg",
+         tails[rank(nruns, 50)], tails[rank(nruns, 90)], tails[rank(nruns, 99)],
+         tails[rank(nruns, 99.9)], tails[nruns - 1]);
+  printf("\n%d flows completed, %d did not\n", ncompletions, nincomplete);
+  print_stopped(nstopped, nruns, params.drain_limit);
+  printf("loss recovery:         %.1f%% of flow time, %.1f%% for the flows from p99 on\n",
+         flow_time > 0 ? 100 * recovery / flow_time : 0.0,
+         tail_time > 0 ? 100 * tail_recovery / tail_time : 0.0);
+  free(completions);
+  free(runs);
+  free(tails);
+  return emulator_close() < 0 || nstopped > 0 ? 1 : 0;
+}
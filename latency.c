@@ -0,0 +1,59 @@
+#include <math.h>
+#include "latency.h"
+
+/* returns the bucket of latency, within the range */
+static int bucket(double latency)
+{
+  int exponent, i;
+  double mantissa;
+
+  if (latency <= 0)
+    return 0;
+  mantissa = frexp(latency, &exponent); /* latency = mantissa 2^exponent, mantissa in [0.5,1) */
+  exponent -= 1 + LATENCY_MIN_EXP;
+  if (exponent < 0)
+    return 0;
+  if (exponent >= LATENCY_EXPONENTS)
+    return LATENCY_BUCKETS - 1;
+  i = (int)((2 * mantissa - 1) * LATENCY_SUB_BUCKETS);
+  return exponent * LATENCY_SUB_BUCKETS + i;
+}
+
+/* returns the upper end of bucket i */
+static double bucket_end(int i)
+{
+  return ldexp(1 + (double)(i % LATENCY_SUB_BUCKETS + 1) / LATENCY_SUB_BUCKETS,
+               i / LATENCY_SUB_BUCKETS + LATENCY_MIN_EXP);
+}
+
+void latency_add(latency_histogram_t *histogram, double latency)
+{
+  histogram->counts[bucket(latency)]++;
+  histogram->n++;
+  if (latency > histogram->max)
+    histogram->max = latency;
+}
+
+void latency_merge(latency_histogram_t *histogram, const latency_histogram_t *from)
+{
+  for (int i = 0; i < LATENCY_BUCKETS; i++)
+    histogram->counts[i] += from->counts[i];
+  histogram->n += from->n;
+  if (from->max > histogram->max)
+    histogram->max = from->max;
+}
+
+double latency_percentile(const latency_histogram_t *histogram, double percent)
+{
+  long rank = (long)ceil(percent / 100 * histogram->n), seen = 0;
+  int i;
+
+  if (histogram->n == 0)
+    return 0;
+  if (rank < 1)
+    rank = 1;
+  for (i = 0; i < LATENCY_BUCKETS - 1; i++)
+    if ((seen += histogram->counts[i]) >= rank)
+      break;
+  return bucket_end(i) < histogram->max ? bucket_end(i) : histogram->max;
+}
@@ -0,0 +1,24 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+#include "emulator.h"
+
+/* ******************************************************************
+ LATENCY HISTOGRAM
+
+   The latencies of the messages delivered, from layer 5 at the sender
+   to layer 5 at the receiver, counted as in HdrHistogram: each power
+   of two is split into LATENCY_SUB_BUCKETS equal buckets, so a bucket
+   is at most 1/32 of the values it holds wide whatever their scale,
+   and the histogram takes the same memory for a billion messages as
+   for one.  A percentile is the upper end of the bucket it falls in,
+   no more than the largest latency, which is kept exactly.
+**********************************************************************/
+
+void latency_add(latency_histogram_t *histogram, double latency);
+/* adds the counts of from to histogram */
+void latency_merge(latency_histogram_t *histogram, const latency_histogram_t *from);
+/* returns the latency percentile percent of the messages are at most, */
+/* by nearest rank, 0 if there are none                                */
+double latency_percentile(const latency_histogram_t *histogram, double percent);
+
+#endif
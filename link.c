@@ -0,0 +1,140 @@
+#include <math.h>
+#include <stdlib.h>
+#include "link.h"
+
+void link_init(link_t *link, const emulator_params_t *params, link_stats_t *stats)
+{
+  link->params = params;
+  link->stats = stats;
+  link->departures = NULL;
+  link->head = link->count = link->size = 0;
+  link->busy_until = link->last_change = 0.0;
+  link->red_avg = 0.0;
+  link->red_count = 0;
+}
+
+/* lets the packets that left before now go and accounts the occupancy */
+static void advance(link_t *link, double now)
+{
+  double departure;
+
+  while (link->count > 0 && (departure = link->departures[link->head]) <= now)
+  {
+    link->stats->queue_area += link->count * (departure - link->last_change);
+    link->last_change = departure;
+    link->head = (link->head + 1) % link->size;
+    link->count--;
+  }
+  link->stats->queue_area += link->count * (now - link->last_change);
+  link->last_change = now;
+}
+
+/* returns 1 if RED drops the packet arriving at a queue of link->count */
+static int red_drop(link_t *link, double now, float x)
+{
+  const emulator_params_t *params = link->params;
+  double w = params->red_weight, pb, pa;
+
+  if (link->count > 0)
+    link->red_avg = (1 - w) * link->red_avg + w * link->count;
+  else
+  {
+    /* the average decays as if small packets had arrived while idle */
+    double idle = (now - link->busy_until) * params->bandwidth / LINK_PACKET_BYTES;
+    link->red_avg *= pow(1 - w, idle > 0 ? idle : 0);
+  }
+
+  if (link->red_avg < params->red_min)
+  {
+    link->red_count = 0;
+    return 0;
+  }
+  if (link->red_avg >= params->red_max)
+  {
+    link->red_count = 0;
+    return 1;
+  }
+  link->red_count++;
+  pb = params->red_maxp * (link->red_avg - params->red_min) / (params->red_max - params->red_min);
+  /* spreads the drops evenly between packets */
+  pa = link->red_count * pb < 1 ? pb / (1 - link->red_count * pb) : 1;
+  if (x < pa)
+  {
+    link->red_count = 0;
+    return 1;
+  }
+  return 0;
+}
+
+int link_admit(link_t *link, double now, float x, int *ecn)
+{
+  int threshold = link->params->ecn_threshold, mark = 0;
+
+  advance(link, now);
+  if (link->params->queue_policy == QUEUE_RED && red_drop(link, now, x))
+  {
+    if (threshold == 0 || *ecn == ECN_NOT_ECT)
+    {
+      link->stats->nearly++;
+      return 0;
+    }
+    mark = 1;
+  }
+  if (link->params->queue_limit > 0 && link->count >= link->params->queue_limit)
+  {
+    link->stats->ndropped++;
+    return 0;
+  }
+  if (threshold > 0 && link->count >= threshold)
+    mark = 1;
+  if (mark && *ecn == ECN_ECT)
+  {
+    *ecn = ECN_CE;
+    link->stats->nmarked++;
+  }
+  return 1;
+}
+
+double link_transmit(link_t *link, double now)
+{
+  link_stats_t *stats = link->stats;
+  double start, transmission = LINK_PACKET_BYTES / link->params->bandwidth;
+  double *departures;
+  int i;
+
+  if (link->count == link->size)
+  {
+    /* an unlimited buffer grows, keeping the ring in order */
+    departures = (double *)malloc((link->size == 0 ? 64 : link->size * 2) * sizeof(double));
+    for (i = 0; i < link->count; i++)
+      departures[i] = link->departures[(link->head + i) % link->size];
+    free(link->departures);
+    link->departures = departures;
+    link->head = 0;
+    link->size = link->size == 0 ? 64 : link->size * 2;
+  }
+
+  start = now > link->busy_until ? now : link->busy_until;
+  link->busy_until = start + transmission;
+  link->departures[(link->head + link->count) % link->size] = link->busy_until;
+  link->count++;
+
+  stats->npackets++;
+  stats->busy_time += transmission;
+  stats->delay_sum += start - now;
+  if (start - now > stats->max_delay)
+    stats->max_delay = start - now;
+  if (link->count > stats->peak_queue)
+    stats->peak_queue = link->count;
+  return link->busy_until + link->params->propdelay;
+}
+
+void link_close(link_t *link, double now)
+{
+  advance(link, now);
+  if (link->busy_until > now)
+    link->stats->busy_time -= link->busy_until - now; /* still to transmit */
+  free(link->departures);
+  link->departures = NULL;
+  link->head = link->count = link->size = 0;
+}
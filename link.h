@@ -0,0 +1,45 @@
+#ifndef LINK_H
+#define LINK_H
+#include "emulator.h"
+
+/* ******************************************************************
+ BOTTLENECK LINK
+
+   One direction of the medium when emulator_params_t.bandwidth > 0.
+   Packets are sent one after another at the link rate (serialization
+   takes LINK_PACKET_BYTES / bandwidth time units), then propagate for
+   propdelay.  Packets waiting for or in transmission occupy a buffer
+   of queue_limit packets, which admits them with a drop-tail or RED
+   policy.  Occupancy is tracked from the departure times, so the link
+   needs no events of its own.  With an ecn_threshold, an ECN_ECT
+   packet that finds that many packets in the buffer is marked ECN_CE,
+   and one RED would drop early is marked instead.
+**********************************************************************/
+
+#define LINK_PACKET_BYTES (4 * 4 + 20) /* flowid, seqnum, acknum, checksum, payload */
+
+typedef struct link_s
+{
+  const emulator_params_t *params;
+  link_stats_t *stats;
+
+  double *departures; /* ring of departure times of the buffered packets */
+  int head, count, size;
+  double busy_until;  /* when the last buffered packet leaves */
+  double last_change; /* time occupancy_area was last brought up to */
+
+  double red_avg;     /* RED average queue length */
+  int red_count;      /* packets admitted since the last RED drop */
+} link_t;
+
+void link_init(link_t *link, const emulator_params_t *params, link_stats_t *stats);
+/* returns 0 if the packet offered at time now is dropped by the buffer; */
+/* x is uniform in [0,1] and only used by RED.  *ecn is the ECN_ field   */
+/* of the packet, which the link may mark.                               */
+int link_admit(link_t *link, double now, float x, int *ecn);
+/* sends an admitted packet, returns its arrival time at the other side */
+double link_transmit(link_t *link, double now);
+/* accounts the occupancy up to time now and releases the buffer */
+void link_close(link_t *link, double now);
+
+#endif
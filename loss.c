@@ -0,0 +1,132 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "backend.h"
+#include "loss.h"
+
+/* returns 1 and the next record of the trace in *value, or 0 if the */
+/* trace from cursor on has no record                                 */
+static int next_record(loss_model_t *model, double *value)
+{
+  const char *trace = model->trace;
+  char token[64];
+  size_t i = model->cursor;
+  int n;
+
+  for (;;)
+  {
+    while (i < model->trace_size && (trace[i] == ' ' || trace[i] == '\t' ||
+                                     trace[i] == '\r' || trace[i] == '\n'))
+      i++;
+    if (i < model->trace_size && trace[i] == '#')
+    {
+      while (i < model->trace_size && trace[i] != '\n')
+        i++;
+      continue;
+    }
+    if (i == model->trace_size)
+      return 0;
+    /* the mapping is not NUL terminated, so copy the token out */
+    for (n = 0; i < model->trace_size && n < (int)sizeof(token) - 1 &&
+                trace[i] > ' ' && trace[i] != '#';
+         n++)
+      token[n] = trace[i++];
+    token[n] = '\0';
+    model->cursor = i;
+    *value = atof(token);
+    return 1;
+  }
+}
+
+int loss_open(loss_model_t *model, const emulator_params_t *params)
+{
+  struct stat st;
+  double value;
+  int fd;
+
+  model->params = params;
+  model->bad[A] = model->bad[B] = 0;
+  model->burst[A] = model->burst[B] = 0;
+  model->trace = NULL;
+  model->trace_size = model->cursor = 0;
+  if (params->loss_model != LOSS_TRACE)
+    return 0;
+
+  if ((fd = open(params->loss_trace, O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+  {
+    perror(params->loss_trace);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  if (st.st_size > 0)
+    model->trace = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (model->trace == MAP_FAILED)
+  {
+    perror(params->loss_trace);
+    model->trace = NULL;
+    return -1;
+  }
+  model->trace_size = st.st_size;
+  if (model->trace == NULL || !next_record(model, &value))
+  {
+    fprintf(stderr, "%s: no records in the loss trace\n", params->loss_trace);
+    loss_close(model);
+    return -1;
+  }
+  model->cursor = 0;
+  madvise((void *)model->trace, model->trace_size, MADV_SEQUENTIAL);
+  return 0;
+}
+
+int loss_draw(loss_model_t *model, int AorB, double *delay, emulator_stats_t *stats)
+{
+  const emulator_params_t *params = model->params;
+  double record;
+  int lost;
+
+  *delay = -1;
+  switch (params->loss_model)
+  {
+  case LOSS_GILBERT:
+    if (jimsrand() < (model->bad[AorB] ? params->ge_r : params->ge_p))
+      model->bad[AorB] = !model->bad[AorB];
+    lost = jimsrand() < (model->bad[AorB] ? params->ge_loss_bad : params->ge_loss_good);
+    break;
+  case LOSS_TRACE:
+    if (!next_record(model, &record))
+    {
+      model->cursor = 0; /* start the trace over */
+      next_record(model, &record);
+    }
+    lost = record < 0;
+    if (!lost)
+      *delay = record;
+    break;
+  default:
+    lost = jimsrand() < params->lossprob;
+  }
+
+  if (lost)
+  {
+    if (model->burst[AorB]++ == 0)
+      stats->nloss_bursts++;
+    if (model->burst[AorB] > stats->max_loss_burst)
+      stats->max_loss_burst = model->burst[AorB];
+  }
+  else
+    model->burst[AorB] = 0;
+  return lost;
+}
+
+void loss_close(loss_model_t *model)
+{
+  if (model->trace != NULL)
+    munmap((void *)model->trace, model->trace_size);
+  model->trace = NULL;
+  model->trace_size = model->cursor = 0;
+}
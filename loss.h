@@ -0,0 +1,42 @@
+#ifndef LOSS_H
+#define LOSS_H
+#include <stddef.h>
+#include "emulator.h"
+
+/* ******************************************************************
+ LOSS MODELS
+
+   Decides which packets the medium loses, by emulator_params_t
+   loss_model:
+   - LOSS_BERNOULLI: every packet is lost with probability lossprob.
+   - LOSS_GILBERT: each direction is a two state Gilbert-Elliott
+     channel.  Before every packet it moves from good to bad with
+     probability ge_p and from bad to good with probability ge_r, then
+     loses the packet with probability ge_loss_good or ge_loss_bad.
+   - LOSS_TRACE: replays loss_trace, a text file with one record per
+     packet, in the order packets are sent in either direction.  A
+     negative record is a loss, any other the one way delay of the
+     packet.  '#' starts a comment.  The file is memory mapped and read
+     sequentially, wrapping around at its end, so traces of any length
+     stream without being loaded.
+**********************************************************************/
+
+typedef struct loss_model_s
+{
+  const emulator_params_t *params;
+  int bad[2];         /* Gilbert-Elliott state of the medium from each entity */
+  int burst[2];       /* consecutive packets lost from each entity */
+  const char *trace;  /* mapped loss_trace */
+  size_t trace_size;
+  size_t cursor;      /* offset of the next record */
+} loss_model_t;
+
+/* returns 0, or -1 (after printing why) if the trace can not be used */
+int loss_open(loss_model_t *model, const emulator_params_t *params);
+/* returns 1 if the packet sent by AorB is lost.  Otherwise *delay is the */
+/* delay the trace gives it, or -1 if the model does not set delays.      */
+/* Loss bursts are accounted in stats.                                    */
+int loss_draw(loss_model_t *model, int AorB, double *delay, emulator_stats_t *stats);
+void loss_close(loss_model_t *model);
+
+#endif
@@ -0,0 +1,260 @@
+#include <stdlib.h>
+#include <string.h>
+#include "options.h"
+
+const char *const arrival_names[] = {"uniform", "poisson", "onoff", "bulk", "trace", "none"};
+
+/* returns the ARRIVAL_ model named by the n characters at name, or -1 */
+static int arrival_model(const char *name, size_t n)
+{
+  for (int i = 0; i <= ARRIVAL_NONE; i++)
+    if (strlen(arrival_names[i]) == n && strncmp(name, arrival_names[i], n) == 0)
+      return i;
+  return -1;
+}
+
+void emulator_default_params(emulator_params_t *params)
+{
+  params->nsimmax = 100;
+  params->lossprob = 0.2;
+  params->corruptprob = 0.2;
+  params->ber = 0;
+  params->lambda = 10;
+  params->bidirectional = 1;
+  params->nflows = 1;
+  params->trace = 1;
+  params->seed = 9999;
+  params->bandwidth = 0;
+  params->propdelay = 5;
+  params->queue_limit = 64;
+  params->queue_policy = QUEUE_DROPTAIL;
+  params->red_min = 5;
+  params->red_max = 15;
+  params->red_maxp = 0.1;
+  params->red_weight = 0.002;
+  params->ecn_threshold = 0;
+  params->loss_model = LOSS_BERNOULLI;
+  params->ge_p = 0.01;
+  params->ge_r = 0.3;
+  params->ge_loss_good = 0;
+  params->ge_loss_bad = 1;
+  params->loss_trace = NULL;
+  params->record = NULL;
+  params->samples = NULL;
+  params->sample_interval = 100;
+  params->rcvbuf = 0;
+  params->read_rate = 0;
+  params->arrival[A] = params->arrival[B] = ARRIVAL_UNIFORM;
+  params->on_time = 100;
+  params->off_time = 100;
+  params->pareto_shape = 1.5;
+  params->bulk_depth = 8;
+  params->arrival_trace = NULL;
+  params->drain = 0;
+  params->drain_limit = 0;
+  params->pcap = NULL;
+  params->profile = 0;
+  params->topology = NULL;
+  params->fec_group = 0;
+  params->handshake = HANDSHAKE_NONE;
+  params->window = 0;
+  params->timeout = 0;
+}
+
+int emulator_option(int opt, const char *arg, emulator_params_t *params)
+{
+  switch (opt)
+  {
+  case 'n':
+    params->nsimmax = atoi(arg);
+    return params->nsimmax > 0 ? 1 : -1;
+  case 'l':
+    params->lossprob = atof(arg);
+    return params->lossprob >= 0 && params->lossprob <= 1 ? 1 : -1;
+  case 'c':
+    params->corruptprob = atof(arg);
+    return params->corruptprob >= 0 && params->corruptprob <= 1 ? 1 : -1;
+  case 'e':
+    params->ber = atof(arg);
+    return params->ber >= 0 && params->ber <= 1 ? 1 : -1;
+  case 't':
+    params->lambda = atof(arg);
+    return params->lambda > 0 ? 1 : -1;
+  case 'f':
+    params->nflows = atoi(arg);
+    return params->nflows > 0 ? 1 : -1;
+  case 'T':
+    params->trace = atoi(arg);
+    return 1;
+  case 's':
+    params->seed = strtoul(arg, NULL, 10);
+    return 1;
+  case 'u':
+    params->bidirectional = 0;
+    return 1;
+  case 'b':
+    params->bandwidth = atof(arg);
+    return params->bandwidth >= 0 ? 1 : -1;
+  case 'd':
+    params->propdelay = atof(arg);
+    return params->propdelay >= 0 ? 1 : -1;
+  case 'q':
+    params->queue_limit = atoi(arg);
+    return params->queue_limit >= 0 ? 1 : -1;
+  case 'Q':
+    if (strcmp(arg, "droptail") == 0)
+      params->queue_policy = QUEUE_DROPTAIL;
+    else if (strcmp(arg, "red") == 0)
+      params->queue_policy = QUEUE_RED;
+    else
+      return -1;
+    return 1;
+  case 'R':
+    if (sscanf(arg, "%f,%f,%f", &params->red_min, &params->red_max, &params->red_maxp) != 3 ||
+        params->red_max <= params->red_min || params->red_maxp <= 0 || params->red_maxp > 1)
+      return -1;
+    return 1;
+  case 'E':
+    params->ecn_threshold = atoi(arg);
+    return params->ecn_threshold >= 0 ? 1 : -1;
+  case 'k':
+    params->fec_group = atoi(arg);
+    return params->fec_group >= 0 && params->fec_group <= FEC_GROUP_MAX ? 1 : -1;
+  case 'N':
+    params->window = atoi(arg);
+    return params->window >= 0 ? 1 : -1;
+  case 'Y':
+    params->timeout = atof(arg);
+    return params->timeout >= 0 ? 1 : -1;
+  case 'H':
+    if (strcmp(arg, "none") == 0)
+      params->handshake = HANDSHAKE_NONE;
+    else if (strcmp(arg, "open") == 0)
+      params->handshake = HANDSHAKE_OPEN;
+    else if (strcmp(arg, "fastopen") == 0)
+      params->handshake = HANDSHAKE_FASTOPEN;
+    else
+      return -1;
+    return 1;
+  case 'L':
+    if (strcmp(arg, "bernoulli") == 0)
+      params->loss_model = LOSS_BERNOULLI;
+    else if (strcmp(arg, "gilbert") == 0)
+      params->loss_model = LOSS_GILBERT;
+    else if (strcmp(arg, "trace") == 0 && params->loss_trace != NULL)
+      params->loss_model = LOSS_TRACE;
+    else
+      return -1;
+    return 1;
+  case 'G':
+    if (sscanf(arg, "%f,%f,%f,%f", &params->ge_p, &params->ge_r, &params->ge_loss_good,
+               &params->ge_loss_bad) != 4 ||
+        params->ge_p < 0 || params->ge_p > 1 || params->ge_r < 0 || params->ge_r > 1 ||
+        params->ge_loss_good < 0 || params->ge_loss_good > 1 ||
+        params->ge_loss_bad < 0 || params->ge_loss_bad > 1)
+      return -1;
+    params->loss_model = LOSS_GILBERT;
+    return 1;
+  case 'w':
+    params->record = arg;
+    return 1;
+  case 'S':
+    params->samples = arg;
+    return 1;
+  case 'I':
+    params->sample_interval = atof(arg);
+    return params->sample_interval > 0 ? 1 : -1;
+  case 'W':
+    params->rcvbuf = atoi(arg);
+    return params->rcvbuf >= 0 ? 1 : -1;
+  case 'C':
+    params->read_rate = atof(arg);
+    return params->read_rate >= 0 ? 1 : -1;
+  case 'A':
+  {
+    /* a model for both directions, or "modelA,modelB" */
+    const char *comma = strchr(arg, ',');
+    int a = arrival_model(arg, comma != NULL ? (size_t)(comma - arg) : strlen(arg));
+    int b = comma != NULL ? arrival_model(comma + 1, strlen(comma + 1)) : a;
+    if (a < 0 || b < 0 ||
+        ((a == ARRIVAL_TRACE || b == ARRIVAL_TRACE) && params->arrival_trace == NULL))
+      return -1;
+    params->arrival[A] = a;
+    params->arrival[B] = b;
+    return 1;
+  }
+  case 'O':
+    if (sscanf(arg, "%f,%f,%f", &params->on_time, &params->off_time, &params->pareto_shape) != 3 ||
+        params->on_time <= 0 || params->off_time <= 0 || params->pareto_shape <= 1)
+      return -1;
+    return 1;
+  case 'K':
+    params->bulk_depth = atoi(arg);
+    return params->bulk_depth > 0 ? 1 : -1;
+  case 'X':
+    params->arrival_trace = arg;
+    params->arrival[A] = params->arrival[B] = ARRIVAL_TRACE;
+    return 1;
+  case 'D':
+    params->drain = 1;
+    return 1;
+  case 'j':
+    params->drain_limit = atof(arg);
+    return params->drain_limit >= 0 ? 1 : -1;
+  case 'o':
+    params->pcap = arg;
+    return 1;
+  case 'z':
+    params->profile = 1;
+    return 1;
+  case 'g':
+    params->topology = arg;
+    return 1;
+  case 'F':
+    params->loss_trace = arg;
+    params->loss_model = LOSS_TRACE;
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+void emulator_usage(FILE *out)
+{
+  fprintf(out, "  -n msgs     number of messages to simulate\n");
+  fprintf(out, "  -l prob     packet loss probability\n");
+  fprintf(out, "  -c prob     packet corruption probability\n");
+  fprintf(out, "  -e ber      bit error rate, replaces -c if > 0\n");
+  fprintf(out, "  -t time     average time between messages from layer5\n");
+  fprintf(out, "  -f flows    number of concurrent flows\n");
+  fprintf(out, "  -T level    trace level\n");
+  fprintf(out, "  -s seed     random number generator seed\n");
+  fprintf(out, "  -u          unidirectional, messages only from A to B\n");
+  fprintf(out, "  -b bytes    link bandwidth per time unit, 0 for random delays\n");
+  fprintf(out, "  -d time     link propagation delay\n");
+  fprintf(out, "  -q packets  link buffer size, 0 for no limit\n");
+  fprintf(out, "  -Q policy   link buffer policy: droptail red\n");
+  fprintf(out, "  -R min,max,maxp  RED thresholds and drop probability\n");
+  fprintf(out, "  -E packets  link queue from which ECN capable packets are marked, 0 for none\n");
+  fprintf(out, "  -L model    loss model: bernoulli gilbert trace\n");
+  fprintf(out, "  -G p,r,good,bad  Gilbert-Elliott transition and loss probabilities\n");
+  fprintf(out, "  -F file     loss/delay trace to replay\n");
+  fprintf(out, "  -w file     record the protocol inputs to file\n");
+  fprintf(out, "  -S file     write samples of the protocol state to file, binary if *.bin\n");
+  fprintf(out, "  -o file     write a pcapng capture of the packets to file\n");
+  fprintf(out, "  -I time     simulation time between samples\n");
+  fprintf(out, "  -W msgs     receive buffer of each flow, 0 for no limit\n");
+  fprintf(out, "  -C rate     messages per time unit layer5 reads, 0 for at once\n");
+  fprintf(out, "  -A model[,model]  arrivals from A and B: uniform poisson onoff bulk trace none\n");
+  fprintf(out, "  -O on,off,shape   mean on and off periods and Pareto shape of onoff\n");
+  fprintf(out, "  -K msgs     messages bulk keeps outstanding per flow\n");
+  fprintf(out, "  -X file     arrival trace to replay\n");
+  fprintf(out, "  -k packets  go-back-N adds a parity packet per group of packets, 0 for none\n");
+  fprintf(out, "  -H mode     connection handshake: none open fastopen\n");
+  fprintf(out, "  -N packets  go-back-N window, 0 for its default\n");
+  fprintf(out, "  -Y time     retransmission timeout, 0 for the protocol's default\n");
+  fprintf(out, "  -D          after the last message, run until all are delivered and ACKed\n");
+  fprintf(out, "  -j time     with -D, fail if not drained this long after the last message\n");
+  fprintf(out, "  -g file     hosts, routers and links to run over, see topology.h\n");
+  fprintf(out, "  -z          profile the simulator and print where the time goes\n");
+}
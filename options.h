@@ -0,0 +1,17 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+#include <stdio.h>
+#include "emulator.h"
+
+/* getopt() letters understood by emulator_option(), shared by every tool */
+#define EMULATOR_OPTIONS "n:l:c:e:t:f:T:s:ub:d:q:Q:R:L:G:F:w:S:I:W:C:A:O:K:X:Do:zg:E:k:H:N:Y:j:"
+
+/* applies one command line option to params; returns 0 if opt is not an */
+/* emulator option, -1 if its argument is invalid                        */
+int emulator_option(int opt, const char *arg, emulator_params_t *params);
+void emulator_usage(FILE *out);
+
+/* names of the ARRIVAL_ models, as -A takes them */
+extern const char *const arrival_names[];
+
+#endif
@@ -0,0 +1,85 @@
+#include <stdlib.h>
+#include "packet.h"
+
+void get_buffer_from_packet(pkt_t *packet, char *buffer)
+{
+  // Loads seqnum to buffer
+  char *tmp_buffer = buffer;
+  *(tmp_buffer + 0) = (packet->seqnum >> 0);
+  *(tmp_buffer + 1) = (packet->seqnum >> 8);
+  *(tmp_buffer + 2) = (packet->seqnum >> 16);
+  *(tmp_buffer + 3) = (packet->seqnum >> 24);
+
+  // Loads acknum to buffer
+  tmp_buffer = buffer + 4;
+  *(tmp_buffer + 0) = (packet->acknum >> 0);
+  *(tmp_buffer + 1) = (packet->acknum >> 8);
+  *(tmp_buffer + 2) = (packet->acknum >> 16);
+  *(tmp_buffer + 3) = (packet->acknum >> 24);
+
+  // Loads payload to buffer
+  tmp_buffer = buffer + 8;
+  for (int i = 0; i < 20; i++)
+  {
+    tmp_buffer[i] = packet->payload[i];
+  }
+}
+
+int get_checksum_from_buffer(char *buffer, size_t size)
+{
+  unsigned int cksum = 0;
+  while (size > 1)
+  {
+    cksum += *((unsigned short *)(buffer + 1));
+    size -= 2;
+    buffer += 2;
+  }
+  if (size)
+    cksum += (unsigned short)(0x00FF & *buffer);
+
+  cksum = (~cksum & 0xffff);
+  return cksum;
+}
+
+int get_checksum(pkt_t *packet)
+{
+  char buffer[sizeof(pkt_t)] = {0x0};
+
+  get_buffer_from_packet(packet, buffer);
+
+  int checksum = get_checksum_from_buffer(buffer, 20);
+
+  return checksum;
+}
+
+int is_corrupted(pkt_t *packet)
+{
+  int checksum = get_checksum(packet);
+  return checksum != packet->checksum;
+}
+
+pkt_t *get_pkt_from_msg(msg_t *msg, int flowid, int sequence, int acknum)
+{
+  pkt_t *packet = (pkt_t *)memory_alloc(MEMORY_WINDOW, sizeof(pkt_t));
+
+  packet->flowid = flowid;
+  packet->seqnum = sequence;
+  packet->acknum = acknum;
+
+  for (int i = 0; i < 20; i++)
+  {
+    packet->payload[i] = msg->data[i];
+  }
+
+  packet->checksum = get_checksum(packet);
+  packet->ecn = ECN_NOT_ECT;
+
+  return packet;
+}
+
+int is_ack_packet(pkt_t *packet)
+{
+  return packet->payload[0] == 'A' &&
+         packet->payload[1] == 'C' &&
+         packet->payload[2] == 'K';
+}
@@ -0,0 +1,15 @@
+#ifndef PACKET_H
+#define PACKET_H
+#include <stddef.h>
+#include "emulator.h"
+
+/* packet routines shared by the alternating bit and go-back-n protocols */
+void get_buffer_from_packet(pkt_t *packet, char *buffer);
+int get_checksum_from_buffer(char *buffer, size_t size);
+int get_checksum(pkt_t *packet);
+int is_corrupted(pkt_t *packet);
+/* the packet is accounted in MEMORY_WINDOW, free it with memory_free() */
+pkt_t *get_pkt_from_msg(msg_t *msg, int flowid, int sequence, int acknum);
+int is_ack_packet(pkt_t *packet);
+
+#endif
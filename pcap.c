@@ -0,0 +1,193 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "pcap.h"
+
+#define PCAP_BUFFER (1 << 20)
+
+#define BLOCK_SHB 0x0A0D0D0A /* section header */
+#define BLOCK_IDB 0x00000001 /* interface description */
+#define BLOCK_EPB 0x00000006 /* enhanced packet */
+#define LINKTYPE_RAW 101     /* packets start with the IP header */
+
+#define OPT_END 0
+#define OPT_COMMENT 1
+#define OPT_IF_NAME 2
+#define OPT_IF_TSRESOL 9
+#define OPT_EPB_FLAGS 2
+
+#define IP_HEADER 20
+#define UDP_HEADER 8
+#define PACKET_BYTES (IP_HEADER + UDP_HEADER + 36)
+
+static void put32(FILE *file, uint32_t value)
+{
+  fwrite(&value, 4, 1, file);
+}
+
+static void put16(FILE *file, uint16_t value)
+{
+  fwrite(&value, 2, 1, file);
+}
+
+/* writes an option to file, its value padded to 32 bits */
+static void write_option(FILE *file, uint16_t code, const void *value, size_t length)
+{
+  static const char padding[4] = {0};
+
+  put16(file, code);
+  put16(file, length);
+  fwrite(value, length, 1, file);
+  fwrite(padding, (4 - length % 4) % 4, 1, file);
+}
+
+/* puts an option at p, the value of 32 bits or the bytes at value, and */
+/* returns the end of the option                                        */
+static char *put_option(char *p, uint16_t code, uint32_t number, const void *value,
+                        size_t length)
+{
+  uint16_t header[2] = {code, length};
+
+  memcpy(p, header, 4);
+  memset(p + 4, 0, (length + 3) / 4 * 4);
+  memcpy(p + 4, value != NULL ? value : (const void *)&number, length);
+  return p + 4 + (length + 3) / 4 * 4;
+}
+
+static size_t option_size(size_t length)
+{
+  return 4 + (length + 3) / 4 * 4;
+}
+
+static void write_interface(FILE *file, const char *name)
+{
+  uint8_t tsresol = 9; /* nanoseconds */
+  uint32_t size = 20 + option_size(strlen(name)) + option_size(1) + 4;
+
+  put32(file, BLOCK_IDB);
+  put32(file, size);
+  put16(file, LINKTYPE_RAW);
+  put16(file, 0);
+  put32(file, 0); /* no snap length */
+  write_option(file, OPT_IF_NAME, name, strlen(name));
+  write_option(file, OPT_IF_TSRESOL, &tsresol, 1);
+  put32(file, OPT_END);
+  put32(file, size);
+}
+
+int pcap_open(pcap_writer_t *writer, const char *path)
+{
+  if ((writer->file = fopen(path, "wb")) == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  writer->buffer = (char *)malloc(PCAP_BUFFER);
+  setvbuf(writer->file, writer->buffer, _IOFBF, PCAP_BUFFER);
+  writer->ipid = 0;
+
+  put32(writer->file, BLOCK_SHB);
+  put32(writer->file, 28);
+  put32(writer->file, 0x1A2B3C4D); /* byte order magic */
+  put16(writer->file, 1);          /* version 1.0 */
+  put16(writer->file, 0);
+  put32(writer->file, 0xFFFFFFFF); /* section length not known */
+  put32(writer->file, 0xFFFFFFFF);
+  put32(writer->file, 28);
+  write_interface(writer->file, "A");
+  write_interface(writer->file, "B");
+  return 0;
+}
+
+static uint16_t ip_checksum(const uint8_t *header)
+{
+  uint32_t sum = 0;
+
+  for (int i = 0; i < IP_HEADER; i += 2)
+    sum += header[i] << 8 | header[i + 1];
+  while (sum >> 16)
+    sum = (sum & 0xFFFF) + (sum >> 16);
+  return ~sum;
+}
+
+static void build_packet(pcap_writer_t *writer, int from, const pkt_t *packet, uint8_t *bytes)
+{
+  uint16_t port = htons(10000 + packet->flowid % 50000), length, checksum;
+  uint32_t field;
+
+  memset(bytes, 0, IP_HEADER + UDP_HEADER);
+  bytes[0] = 0x45; /* IPv4, 20 byte header */
+  bytes[1] = packet->ecn & 3; /* ECN field of the traffic class */
+  length = htons(PACKET_BYTES);
+  memcpy(bytes + 2, &length, 2);
+  bytes[4] = writer->ipid >> 8;
+  bytes[5] = writer->ipid++;
+  bytes[8] = 64;  /* TTL */
+  bytes[9] = 17;  /* UDP */
+  bytes[12] = bytes[16] = 10;
+  bytes[15] = from == A ? 1 : 2;
+  bytes[19] = from == A ? 2 : 1;
+  checksum = htons(ip_checksum(bytes));
+  memcpy(bytes + 10, &checksum, 2);
+
+  memcpy(bytes + IP_HEADER, &port, 2);
+  memcpy(bytes + IP_HEADER + 2, &port, 2);
+  length = htons(UDP_HEADER + 36);
+  memcpy(bytes + IP_HEADER + 4, &length, 2); /* UDP checksum 0: none */
+
+  bytes += IP_HEADER + UDP_HEADER;
+  field = htonl(packet->flowid);
+  memcpy(bytes + 0, &field, 4);
+  field = htonl(packet->seqnum);
+  memcpy(bytes + 4, &field, 4);
+  field = htonl(packet->acknum);
+  memcpy(bytes + 8, &field, 4);
+  field = htonl(packet->checksum);
+  memcpy(bytes + 12, &field, 4);
+  memcpy(bytes + 16, packet->payload, 20);
+}
+
+void pcap_write(pcap_writer_t *writer, double time, int AorB, int outbound,
+                const pkt_t *packet, const char *comment)
+{
+  /* the block is built whole, one fwrite per packet */
+  uint32_t block[(28 + PACKET_BYTES + 12 + 4 + 256 + 8) / 4];
+  uint64_t ns = time * 1e6; /* a time unit is a millisecond */
+  size_t comment_length = comment != NULL ? strlen(comment) : 0;
+  uint32_t size = 28 + PACKET_BYTES + option_size(4) + 8;
+  char *p;
+
+  if (comment_length > 255)
+    comment_length = 255;
+  if (comment != NULL)
+    size += option_size(comment_length);
+  block[0] = BLOCK_EPB;
+  block[1] = size;
+  block[2] = AorB; /* interface */
+  block[3] = ns >> 32;
+  block[4] = ns;
+  block[5] = block[6] = PACKET_BYTES;
+  build_packet(writer, outbound ? AorB : !AorB, packet, (uint8_t *)&block[7]);
+  p = (char *)&block[7] + PACKET_BYTES; /* a multiple of 4 bytes */
+  p = put_option(p, OPT_EPB_FLAGS, outbound ? 2 : 1, NULL, 4);
+  if (comment != NULL)
+    p = put_option(p, OPT_COMMENT, 0, comment, comment_length);
+  memset(p, 0, 4); /* OPT_END */
+  memcpy(p + 4, &size, 4);
+  fwrite(block, size, 1, writer->file);
+}
+
+int pcap_close(pcap_writer_t *writer)
+{
+  int status = ferror(writer->file) | fclose(writer->file);
+
+  free(writer->buffer);
+  writer->file = NULL;
+  if (status != 0)
+  {
+    perror("pcap_close");
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef PCAP_H
+#define PCAP_H
+#include <stdio.h>
+#include "emulator.h"
+
+/* ******************************************************************
+ PACKET CAPTURE
+
+   Writes the packets of a run to a pcapng file for Wireshark or
+   tcpdump.  Every packet appears twice: on the interface of the
+   entity that passed it to tolayer3 (outbound), and on the interface
+   of the other entity when the medium delivers it (inbound).  The
+   sent copy of a packet the medium loses, drops at the link buffer
+   or corrupts carries a comment saying so; a delivered corrupted
+   packet carries the corrupted bytes and a comment.  Over a topology
+   the comment of the sent copy tells what the first link did, and the
+   packets lost further on are missing from the other interface.
+
+   Packets are IPv4/UDP datagrams from 10.0.0.1 (A) or 10.0.0.2 (B),
+   from and to port 10000 + flowid modulo 50000, holding the fields of
+   pkt_t in network byte order, as udp.c sends them, with the ECN field
+   of pkt_t in the IP header.  A simulation
+   time unit is shown as a millisecond.  Records go through a large
+   stdio buffer, so a capture costs a copy and a write per packet.
+**********************************************************************/
+
+/* comments of the sent copy of a packet */
+#define PCAP_LOST "lost"
+#define PCAP_DROPPED "dropped by the link buffer"
+#define PCAP_CORRUPTED "corrupted"
+
+typedef struct pcap_writer_s
+{
+  FILE *file;
+  char *buffer;       /* stdio buffer of file */
+  unsigned short ipid; /* of the next IP header */
+} pcap_writer_t;
+
+/* returns 0, or -1 after printing why path can not be written */
+int pcap_open(pcap_writer_t *writer, const char *path);
+/* writes packet, seen at time on the interface of entity AorB, sent by */
+/* it if outbound, with comment if not NULL                             */
+void pcap_write(pcap_writer_t *writer, double time, int AorB, int outbound,
+                const pkt_t *packet, const char *comment);
+int pcap_close(pcap_writer_t *writer);
+
+#endif
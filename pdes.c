@@ -0,0 +1,552 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "backend.h"
+#include "latency.h"
+#include "pdes.h"
+
+/* possible events: */
+#define TIMER_INTERRUPT 0
+#define FROM_LAYER5 1
+#define FROM_LAYER3 2
+
+#define KEY(AorB, flowid) ((flowid) * 2 + (AorB))
+
+typedef struct pevent_s
+{
+  double evtime; /* event time */
+  int evtype;    /* event type code */
+  int key;       /* endpoint where event occurs */
+  int src;       /* endpoint that created the event */
+  long srcseq;   /* events created by src before this one */
+  int heapidx;   /* position in the event list of the worker */
+  pkt_t pkt;     /* packet, for FROM_LAYER3 */
+} pevent_t;
+
+typedef struct endpoint_s
+{
+  rng_t rng;          /* random stream of the endpoint */
+  long seq;           /* events created so far */
+  double lastarrival; /* latest arrival time of its packets in the medium */
+  pevent_t *timer;    /* running timer, or NULL */
+  int gen;            /* index among the endpoints that generate messages */
+  int quota;          /* messages left to generate */
+  int nmsg;           /* messages generated so far */
+  double last;        /* time of its last message, once quota is 0 */
+} endpoint_t;
+
+typedef struct event_vec_s
+{
+  pevent_t **events;
+  int n, size;
+} event_vec_t;
+
+typedef struct worker_s
+{
+  int id;
+  pthread_t thread;
+  event_vec_t evlist; /* binary heap, see earlier() */
+  event_vec_t *out;   /* events for the endpoints of each other worker */
+  double now;
+  double nextmin;     /* earliest pending event, shared at the barrier */
+  int quota;          /* messages its endpoints have left to generate, and */
+  double last;        /* the latest last message of those that have none,  */
+                      /* shared with nextmin                               */
+  emulator_stats_t stats;
+  long nwindows;
+} worker_t;
+
+static const protocol_t *protocol;
+static float lossprob, corruptprob, lambda;
+static int nflows, ngen;
+static int drain;             /* emulator_params_t.drain */
+static float drain_limit;     /* emulator_params_t.drain_limit */
+static int fec;               /* emulator_params_t.fec_group */
+static int handshake;         /* emulator_params_t.handshake */
+static int window;            /* emulator_params_t.window */
+static float timeout;         /* emulator_params_t.timeout */
+static endpoint_t *endpoints; /* by KEY, each owned by worker KEY % nworkers */
+static worker_t *workers;
+static int nworkers;
+static pthread_barrier_t barrier;
+
+static __thread worker_t *self; /* worker running on this thread */
+
+static double wall_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void vec_push(event_vec_t *vec, pevent_t *p)
+{
+  if (vec->n == vec->size)
+  {
+    vec->size = vec->size == 0 ? 64 : vec->size * 2;
+    vec->events = (pevent_t **)realloc(vec->events, vec->size * sizeof(pevent_t *));
+  }
+  vec->events[vec->n++] = p;
+}
+
+/********************* EVENT HANDLINE ROUTINES *******/
+
+/* the order of events at one endpoint must not depend on the partitioning, */
+/* so ties are broken by the endpoint that created them                     */
+static int earlier(pevent_t *p, pevent_t *q)
+{
+  if (p->evtime != q->evtime)
+    return p->evtime < q->evtime;
+  if (p->src != q->src)
+    return p->src < q->src;
+  return p->srcseq < q->srcseq;
+}
+
+static void placeevent(event_vec_t *heap, pevent_t *p, int i)
+{
+  heap->events[i] = p;
+  p->heapidx = i;
+}
+
+static void siftup(event_vec_t *heap, pevent_t *p, int i)
+{
+  while (i > 0 && earlier(p, heap->events[(i - 1) / 2]))
+  {
+    placeevent(heap, heap->events[(i - 1) / 2], i);
+    i = (i - 1) / 2;
+  }
+  placeevent(heap, p, i);
+}
+
+static void siftdown(event_vec_t *heap, pevent_t *p, int i)
+{
+  int child;
+
+  while ((child = 2 * i + 1) < heap->n)
+  {
+    if (child + 1 < heap->n && earlier(heap->events[child + 1], heap->events[child]))
+      child++;
+    if (!earlier(heap->events[child], p))
+      break;
+    placeevent(heap, heap->events[child], i);
+    i = child;
+  }
+  placeevent(heap, p, i);
+}
+
+static void insertevent(worker_t *w, pevent_t *p)
+{
+  vec_push(&w->evlist, p);
+  siftup(&w->evlist, p, w->evlist.n - 1);
+  if (w->evlist.n > w->stats.peak_events)
+    w->stats.peak_events = w->evlist.n;
+}
+
+static void removeevent(worker_t *w, pevent_t *p)
+{
+  event_vec_t *heap = &w->evlist;
+  pevent_t *last = heap->events[--heap->n];
+
+  if (last == p)
+    return;
+  if (p->heapidx > 0 && earlier(last, heap->events[(p->heapidx - 1) / 2]))
+    siftup(heap, last, p->heapidx);
+  else
+    siftdown(heap, last, p->heapidx);
+}
+
+/* creates an event of endpoint src for endpoint key, and queues it on the */
+/* worker that owns key                                                    */
+static pevent_t *newevent(int src, int key, int evtype, double evtime)
+{
+  pevent_t *p = (pevent_t *)malloc(sizeof(pevent_t));
+  int owner = key % nworkers;
+
+  p->evtime = evtime;
+  p->evtype = evtype;
+  p->key = key;
+  p->src = src;
+  p->srcseq = endpoints[src].seq++;
+  if (owner == self->id)
+    insertevent(self, p);
+  else
+    vec_push(&self->out[owner], p);
+  return p;
+}
+
+static void generate_next_arrival(int key)
+{
+  endpoint_t *ep = &endpoints[key];
+  double x;
+
+  if (ep->quota == 0)
+    return;
+  ep->quota--;
+  if (TRACE > 2)
+    printf("          GENERATE NEXT ARRIVAL: creating new arrival\n");
+  /* every endpoint has 1/ngen of the arrival rate of layer 5 */
+  x = lambda * ngen * rng_float(&ep->rng) * 2;
+  newevent(key, key, FROM_LAYER5, self->now + x);
+  if (ep->quota == 0)
+    ep->last = self->now + x;
+}
+
+/* returns whether every message has been generated, from the quotas */
+/* the workers shared, and sets *last to the time of the last one     */
+static int all_generated(double *last)
+{
+  int i;
+
+  *last = 0;
+  for (i = 0; i < nworkers; i++)
+  {
+    if (workers[i].quota > 0)
+      return 0;
+    if (workers[i].last > *last)
+      *last = workers[i].last;
+  }
+  return 1;
+}
+
+static void dispatch(pevent_t *p)
+{
+  endpoint_t *ep = &endpoints[p->key];
+  int AorB = p->key % 2, flowid = p->key / 2;
+  msg_t msg2give;
+
+  self->stats.nevents++;
+  if (p->evtype == FROM_LAYER5)
+  {
+    generate_next_arrival(p->key); /* set up future arrival */
+    /* messages of the endpoint are numbered ngen apart, so that */
+    /* every message of the run has its own number              */
+    layer5_message(&msg2give, ep->nmsg * ngen + ep->gen, self->now);
+    ep->nmsg++;
+    self->stats.nsim++;
+    protocol->output(AorB, flowid, msg2give);
+  }
+  else if (p->evtype == FROM_LAYER3)
+  {
+    protocol->input(AorB, p->pkt);
+  }
+  else
+  {
+    ep->timer = NULL;
+    protocol->timerinterrupt(AorB, flowid);
+  }
+}
+
+static void *worker_main(void *arg)
+{
+  worker_t *w = (worker_t *)arg;
+  double tmin, end, stop, last;
+  pevent_t *p;
+  int key, i, j;
+
+  self = w;
+  protocol->init(A);
+  protocol->init(B);
+  w->now = 0.0;
+  for (key = w->id; key < 2 * nflows; key += nworkers)
+    generate_next_arrival(key);
+
+  for (;;)
+  {
+    w->nextmin = w->evlist.n > 0 ? w->evlist.events[0]->evtime : INFINITY;
+    w->quota = 0;
+    w->last = 0;
+    for (key = w->id; key < 2 * nflows; key += nworkers)
+    {
+      w->quota += endpoints[key].quota;
+      if (endpoints[key].last > w->last)
+        w->last = endpoints[key].last;
+    }
+    pthread_barrier_wait(&barrier);
+    tmin = INFINITY;
+    for (i = 0; i < nworkers; i++)
+      if (workers[i].nextmin < tmin)
+        tmin = workers[i].nextmin;
+    /* like the emulator, the run stops at the last message unless it */
+    /* drains, then at the drain limit if there is one                 */
+    stop = INFINITY;
+    if (all_generated(&last))
+    {
+      w->stats.drain_start = last;
+      if (!drain)
+        stop = last;
+      else if (drain_limit > 0)
+        stop = last + drain_limit;
+    }
+    if (tmin == INFINITY)
+      break;
+    if (tmin > stop)
+    {
+      w->stats.drain_stopped = drain;
+      break;
+    }
+
+    /* nothing sent in [tmin, end) can arrive before end */
+    end = tmin + LOOKAHEAD;
+    w->nwindows++;
+    while (w->evlist.n > 0 && w->evlist.events[0]->evtime < end &&
+           w->evlist.events[0]->evtime <= stop)
+    {
+      p = w->evlist.events[0];
+      removeevent(w, p);
+      w->now = p->evtime;
+      if (w->now > w->stats.time)
+        w->stats.time = w->now;
+      dispatch(p);
+      free(p);
+    }
+    pthread_barrier_wait(&barrier);
+
+    for (i = 0; i < nworkers; i++)
+    {
+      event_vec_t *in = &workers[i].out[w->id];
+      for (j = 0; j < in->n; j++)
+        insertevent(w, in->events[j]);
+      in->n = 0;
+    }
+  }
+
+  protocol->init(A); /* close the flows of this worker */
+  protocol->init(B);
+  for (i = 0; i < w->evlist.n; i++) /* left when the run stopped */
+    free(w->evlist.events[i]);
+  w->evlist.n = 0;
+  return NULL;
+}
+
+int pdes_run(const protocol_t *run_protocol, const emulator_params_t *params,
+             int run_nworkers, emulator_stats_t *stats, pdes_stats_t *pdes_stats)
+{
+  double start;
+  int key, gen, i, j;
+
+  if (run_nworkers < 1)
+    return -1;
+  if (params->bandwidth > 0 || params->topology != NULL)
+  {
+    fprintf(stderr, "pdes_run: the link model and topologies are not supported\n");
+    return -1;
+  }
+  if (params->record != NULL || params->samples != NULL || params->pcap != NULL ||
+      params->profile)
+  {
+    fprintf(stderr, "pdes_run: recording, sampling, capture and profiling are not supported\n");
+    return -1;
+  }
+  if (params->rcvbuf > 0)
+  {
+    fprintf(stderr, "pdes_run: receive buffers are not supported\n");
+    return -1;
+  }
+  if (params->arrival[A] != ARRIVAL_UNIFORM || params->arrival[B] != ARRIVAL_UNIFORM)
+  {
+    fprintf(stderr, "pdes_run: only uniform arrivals are supported\n");
+    return -1;
+  }
+  if (params->loss_model != LOSS_BERNOULLI || params->ber > 0)
+  {
+    fprintf(stderr, "pdes_run: only Bernoulli losses and corruption are supported\n");
+    return -1;
+  }
+  protocol = run_protocol;
+  lossprob = params->lossprob;
+  corruptprob = params->corruptprob;
+  lambda = params->lambda;
+  nflows = params->nflows;
+  drain = params->drain;
+  drain_limit = params->drain_limit;
+  fec = params->fec_group;
+  handshake = params->handshake;
+  window = params->window;
+  timeout = params->timeout;
+  nworkers = run_nworkers;
+  TRACE = params->trace;
+
+  /* only A generates messages unless the run is bidirectional */
+  ngen = params->bidirectional ? 2 * nflows : nflows;
+  endpoints = (endpoint_t *)calloc(2 * nflows, sizeof(endpoint_t));
+  for (key = 0, gen = 0; key < 2 * nflows; key++)
+  {
+    rng_seed(&endpoints[key].rng, params->seed, key);
+    if (key % 2 == B && !params->bidirectional)
+      continue;
+    endpoints[key].gen = gen;
+    endpoints[key].quota = params->nsimmax / ngen + (gen < params->nsimmax % ngen);
+    gen++;
+  }
+
+  workers = (worker_t *)calloc(nworkers, sizeof(worker_t));
+  for (i = 0; i < nworkers; i++)
+  {
+    workers[i].id = i;
+    workers[i].out = (event_vec_t *)calloc(nworkers, sizeof(event_vec_t));
+  }
+  pthread_barrier_init(&barrier, NULL, nworkers);
+
+  layer5_reset();
+  start = wall_clock();
+  if (nworkers == 1)
+    worker_main(&workers[0]);
+  else
+  {
+    for (i = 0; i < nworkers; i++)
+      if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0)
+      {
+        /* the barrier would never open for the workers already started */
+        perror("pthread_create");
+        exit(1);
+      }
+    for (i = 0; i < nworkers; i++)
+      pthread_join(workers[i].thread, NULL);
+  }
+  pdes_stats->elapsed = wall_clock() - start;
+
+  *stats = (emulator_stats_t){0};
+  pdes_stats->nwindows = workers[0].nwindows;
+  for (i = 0; i < nworkers; i++)
+  {
+    emulator_stats_t *ws = &workers[i].stats;
+    if (ws->time > stats->time)
+      stats->time = ws->time;
+    stats->drain_start = ws->drain_start;
+    stats->drain_stopped = ws->drain_stopped;
+    stats->nsim += ws->nsim;
+    stats->ntolayer3 += ws->ntolayer3;
+    stats->nlost += ws->nlost;
+    stats->ncorrupt += ws->ncorrupt;
+    stats->nundetected += ws->nundetected;
+    stats->ndelivered += ws->ndelivered;
+    stats->nduplicate += ws->nduplicate;
+    stats->nunstamped += ws->nunstamped;
+    stats->nbad += ws->nbad;
+    stats->latency_sum += ws->latency_sum;
+    latency_merge(&stats->latency, &ws->latency);
+    stats->nevents += ws->nevents;
+    stats->peak_events += ws->peak_events;
+    free(workers[i].evlist.events);
+    for (j = 0; j < nworkers; j++)
+      free(workers[i].out[j].events);
+    free(workers[i].out);
+  }
+  pthread_barrier_destroy(&barrier);
+  free(workers);
+  free(endpoints);
+  return 0;
+}
+
+/********************** Student-callable ROUTINES ***********************/
+
+void stoptimer(int AorB, int flowid)
+{
+  endpoint_t *ep = &endpoints[KEY(AorB, flowid)];
+
+  if (TRACE > 2)
+    printf("          STOP TIMER: stopping timer at %f\n", self->now);
+  if (ep->timer == NULL)
+  {
+    printf("Warning: unable to cancel your timer. It wasn't running.\n");
+    return;
+  }
+  removeevent(self, ep->timer);
+  free(ep->timer);
+  ep->timer = NULL;
+}
+
+void starttimer(int AorB, int flowid, float increment)
+{
+  int key = KEY(AorB, flowid);
+
+  if (TRACE > 2)
+    printf("          START TIMER: starting timer at %f\n", self->now);
+  if (endpoints[key].timer != NULL)
+  {
+    printf("Warning: attempt to start a timer that is already started\n");
+    return;
+  }
+  endpoints[key].timer = newevent(key, key, TIMER_INTERRUPT, self->now + increment);
+}
+
+void tolayer3(int AorB, pkt_t packet)
+{
+  int key = KEY(AorB, packet.flowid);
+  endpoint_t *ep = &endpoints[key];
+  double lastime;
+  pevent_t *p;
+
+  self->stats.ntolayer3++;
+
+  /* simulate losses: */
+  if (rng_float(&ep->rng) < lossprob)
+  {
+    self->stats.nlost++;
+    if (TRACE > 0)
+      printf("          TOLAYER3: packet being lost\n");
+    return;
+  }
+
+  /* the medium of the endpoint can not reorder, so the packet arrives */
+  /* between 1 and 10 time units after the latest of its packets        */
+  lastime = self->now;
+  if (ep->lastarrival > lastime)
+    lastime = ep->lastarrival;
+  ep->lastarrival = lastime + 1 + 9 * rng_float(&ep->rng);
+
+  /* simulate corruption: */
+  if (rng_float(&ep->rng) < corruptprob)
+  {
+    self->stats.ncorrupt++;
+    corrupt_packet(&packet, rng_float(&ep->rng));
+    if (protocol->is_corrupted != NULL && !protocol->is_corrupted(&packet))
+      self->stats.nundetected++;
+    if (TRACE > 0)
+      printf("          TOLAYER3: packet being corrupted\n");
+  }
+
+  p = newevent(key, key ^ 1, FROM_LAYER3, ep->lastarrival);
+  p->pkt = packet;
+}
+
+void tolayer5(int AorB, int flowid, char *datasent)
+{
+  (void)AorB;
+  (void)flowid;
+  layer5_deliver(&self->stats, datasent, self->now);
+}
+
+int layer5_window(int AorB, int flowid)
+{
+  (void)AorB;
+  (void)flowid;
+  return -1;
+}
+
+double current_time()
+{
+  return self->now;
+}
+
+int fec_group()
+{
+  return fec;
+}
+
+int handshake_mode()
+{
+  return handshake;
+}
+
+int send_window()
+{
+  return window;
+}
+
+float retransmit_timeout()
+{
+  return timeout;
+}
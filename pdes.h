@@ -0,0 +1,44 @@
+#ifndef PDES_H
+#define PDES_H
+#include "emulator.h"
+
+/* ******************************************************************
+ PARALLEL DISCRETE EVENT SIMULATION
+
+   Runs the protocol_t entities of every flow on a pool of worker
+   threads.  The endpoints (A or B side of a flow) are partitioned over
+   the workers, each with its own event list.  tolayer3() never delivers
+   a packet sooner than LOOKAHEAD time units after it was sent, so the
+   workers advance in YAWNS windows: all of them agree on the earliest
+   pending event T, process their events in [T, T + LOOKAHEAD) in
+   parallel, and exchange the packets sent to other workers at a
+   barrier.
+
+   For the result not to depend on the partitioning, every endpoint is
+   independent of the others except through its packets: each one has
+   its own random stream, its own layer 5 arrivals (nsimmax is split
+   evenly between them) and its own FIFO medium to its peer, and events
+   with equal times are ordered by the endpoint that created them.  The
+   run ends at the time of the last message generated, or if it drains,
+   once no event is left or at its drain limit.  The same seed therefore gives the same statistics for any number of
+   workers.  The protocols keep their connection tables per thread, so
+   protocol_t.report is not called.
+**********************************************************************/
+
+#define LOOKAHEAD 1.0
+
+typedef struct pdes_stats_s
+{
+  double elapsed; /* wall clock seconds */
+  long nwindows;  /* YAWNS windows */
+} pdes_stats_t;
+
+/* returns 0, or -1 if nworkers is not positive or params asks for the */
+/* link model or a topology, which give no lookahead between the flows */
+/* of a link, or a loss model other than LOSS_BERNOULLI, bit errors, a  */
+/* record log, samples, a capture, a profile, a receive buffer or an   */
+/* arrival model other than uniform                                     */
+int pdes_run(const protocol_t *protocol, const emulator_params_t *params,
+             int nworkers, emulator_stats_t *stats, pdes_stats_t *pdes_stats);
+
+#endif
@@ -0,0 +1,109 @@
+#include <string.h>
+#include <time.h>
+#include "profile.h"
+
+static const char *const routine_names[PROFILE_ROUTINES] = {
+    "A_output", "B_output", "A_input", "B_input", "A_timerinterrupt", "B_timerinterrupt",
+    "insertevent", "popevent", "starttimer", "stoptimer", "tolayer3", "tolayer5",
+    "generate_next_arrival"};
+
+static double wall_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+uint64_t profile_nanoseconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* returns i with 2^i <= x < 2^(i+1), within the buckets */
+static int bucket(double x)
+{
+  int i = 0;
+
+  while (x >= 2 && i < PROFILE_BUCKETS - 1)
+  {
+    x /= 2;
+    i++;
+  }
+  return i;
+}
+
+void profile_start(profile_t *profile)
+{
+  memset(profile, 0, sizeof(*profile));
+  profile->wall_start = profile->slice_start = wall_clock();
+  profile->start = profile_clock();
+}
+
+void profile_event(profile_t *profile, int type, int pending)
+{
+  double now;
+
+  profile->nevents[type]++;
+  profile->pending[bucket(pending)]++;
+  if (++profile->slice_events == PROFILE_SLICE)
+  {
+    now = wall_clock();
+    if (now > profile->slice_start)
+      profile->rate[bucket(PROFILE_SLICE / (now - profile->slice_start))]++;
+    profile->slice_start = now;
+    profile->slice_events = 0;
+  }
+}
+
+void profile_stop(profile_t *profile)
+{
+  profile->cycles = profile_clock() - profile->start;
+  profile->wall = wall_clock() - profile->wall_start;
+}
+
+static void print_histogram(FILE *out, const long *counts, const char *unit)
+{
+  long total = 0;
+  int i;
+
+  for (i = 0; i < PROFILE_BUCKETS; i++)
+    total += counts[i];
+  for (i = 0; i < PROFILE_BUCKETS; i++)
+    if (counts[i] > 0)
+      fprintf(out, "  %10.0f - %-10.0f %s %10ld  %5.1f%%\n", (double)(1ul << i),
+              (double)(1ul << (i + 1)) - 1, unit, counts[i], 100.0 * counts[i] / total);
+}
+
+void profile_print(FILE *out, const profile_t *profile)
+{
+  uint64_t own = 0;
+  int i;
+
+  fprintf(out, "profile:             %ld timer, %ld layer5, %ld layer3, %ld forward events; "
+               "%.3g cycles in %.3f s\n",
+          profile->nevents[0], profile->nevents[1], profile->nevents[2], profile->nevents[3],
+          (double)profile->cycles, profile->wall);
+  fprintf(out, "  %-22s %10s %14s %7s\n", "routine", "calls", "cycles/call", "share");
+  for (i = 0; i < PROFILE_ROUTINES; i++)
+  {
+    const profile_routine_t *routine = &profile->routines[i];
+
+    own += routine->cycles;
+    if (routine->calls > 0)
+      fprintf(out, "  %-22s %10ld %14.1f %6.1f%%\n", routine_names[i], routine->calls,
+              (double)routine->cycles / routine->calls,
+              profile->cycles > 0 ? 100.0 * routine->cycles / profile->cycles : 0.0);
+  }
+  if (profile->cycles > own)
+    fprintf(out, "  %-22s %10s %14s %6.1f%%\n", "main loop", "", "",
+            100.0 * (profile->cycles - own) / profile->cycles);
+  fprintf(out, "pending events:\n");
+  print_histogram(out, profile->pending, "events");
+  fprintf(out, "events per second, by slices of %d events:\n", PROFILE_SLICE);
+  if (profile->nevents[0] + profile->nevents[1] + profile->nevents[2] + profile->nevents[3] <
+      PROFILE_SLICE)
+    fprintf(out, "  none, the run is shorter than a slice\n");
+  print_histogram(out, profile->rate, "per s ");
+}
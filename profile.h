@@ -0,0 +1,102 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <stdint.h>
+#include <stdio.h>
+
+/* ******************************************************************
+ SIMULATOR SELF-PROFILER
+
+   Counts the events a run simulates by type and times the protocol
+   handlers and the emulator routines they call, so a slow run shows
+   whether the event list, the timers, the medium or the protocol
+   takes the time.  A routine is charged its own cycles: those of the
+   routines it calls (tolayer3 from A_input, insertevent from
+   tolayer3) go to them, and what no routine takes is the main loop.
+   Cycles are read from the time stamp counter, or are nanoseconds on
+   machines without one; reading them twice per call costs some tens
+   of cycles, which the shares include.
+
+   Two histograms with power of two buckets show how the run scales:
+   the events pending when each event is taken from the list, and the
+   events simulated per second of wall clock time, measured over
+   slices of PROFILE_SLICE events.
+**********************************************************************/
+
+/* routines timed, the handlers of A and B first */
+#define PROFILE_OUTPUT 0 /* + AorB */
+#define PROFILE_INPUT 2
+#define PROFILE_TIMER 4
+#define PROFILE_INSERTEVENT 6
+#define PROFILE_POPEVENT 7
+#define PROFILE_STARTTIMER 8
+#define PROFILE_STOPTIMER 9
+#define PROFILE_TOLAYER3 10
+#define PROFILE_TOLAYER5 11
+#define PROFILE_ARRIVAL 12 /* generate_next_arrival */
+#define PROFILE_ROUTINES 13
+
+#define PROFILE_EVENT_TYPES 4 /* timer interrupt, from layer 5, from layer 3, forward */
+#define PROFILE_BUCKETS 32
+#define PROFILE_SLICE 16384
+#define PROFILE_DEPTH 16 /* routines under way, handlers nest two or three deep */
+
+typedef struct profile_routine_s
+{
+  long calls;
+  uint64_t cycles; /* own, without those of the routines it called */
+} profile_routine_t;
+
+typedef struct profile_s
+{
+  long nevents[PROFILE_EVENT_TYPES];
+  profile_routine_t routines[PROFILE_ROUTINES];
+  long pending[PROFILE_BUCKETS]; /* events taken with 2^i to 2^(i+1)-1 pending */
+  long rate[PROFILE_BUCKETS];    /* slices run at 2^i to 2^(i+1) events per second */
+  uint64_t cycles;               /* of the run */
+  double wall;                   /* seconds of the run */
+
+  /* the run under way */
+  uint64_t start;
+  double wall_start, slice_start;
+  long slice_events;
+  int depth;
+  uint64_t entered[PROFILE_DEPTH]; /* cycle count at the call of each routine */
+  uint64_t nested[PROFILE_DEPTH];  /* cycles of the routines it called */
+} profile_t;
+
+uint64_t profile_nanoseconds(); /* profile_clock() without a time stamp counter */
+
+static inline uint64_t profile_clock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return profile_nanoseconds();
+#endif
+}
+
+/* a routine is called, ended by profile_leave() */
+static inline void profile_enter(profile_t *profile)
+{
+  profile->nested[profile->depth] = 0;
+  profile->entered[profile->depth++] = profile_clock();
+}
+
+static inline void profile_leave(profile_t *profile, int routine)
+{
+  uint64_t cycles = profile_clock() - profile->entered[--profile->depth];
+
+  profile->routines[routine].calls++;
+  profile->routines[routine].cycles += cycles - profile->nested[profile->depth];
+  if (profile->depth > 0)
+    profile->nested[profile->depth - 1] += cycles;
+}
+
+void profile_start(profile_t *profile);
+/* an event of type is taken from the list, which held pending events */
+/* with it                                                             */
+void profile_event(profile_t *profile, int type, int pending);
+void profile_stop(profile_t *profile);
+void profile_print(FILE *out, const profile_t *profile);
+
+#endif
@@ -0,0 +1,19 @@
+#include <string.h>
+#include "protocols.h"
+
+const protocol_t *const protocols[] = {
+    &alt_bit_protocol,
+    &goback_n_protocol,
+    &gbn_loss_protocol,
+    &gbn_dctcp_protocol,
+    &gbn_paced_protocol,
+    NULL,
+};
+
+const protocol_t *find_protocol(const char *name)
+{
+  for (int i = 0; protocols[i] != NULL; i++)
+    if (strcmp(protocols[i]->name, name) == 0)
+      return protocols[i];
+  return NULL;
+}
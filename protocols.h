@@ -0,0 +1,16 @@
+#ifndef PROTOCOLS_H
+#define PROTOCOLS_H
+#include "emulator.h"
+
+extern const protocol_t alt_bit_protocol;
+extern const protocol_t goback_n_protocol;
+extern const protocol_t gbn_loss_protocol;
+extern const protocol_t gbn_dctcp_protocol;
+extern const protocol_t gbn_paced_protocol;
+
+/* every protocol the emulator can run, terminated by NULL */
+extern const protocol_t *const protocols[];
+
+const protocol_t *find_protocol(const char *name);
+
+#endif
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "emulator.h"
+#include "options.h"
+#include "pdes.h"
+#include "protocols.h"
+
+/* runs a protocol through the parallel engine on one worker and on -P */
+/* workers, checks that both give the same result and prints the speed-up */
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-p protocol] [-P workers] [options]\n", prog);
+  fprintf(stderr, "  -p name     protocol to run:");
+  for (int i = 0; protocols[i] != NULL; i++)
+    fprintf(stderr, " %s", protocols[i]->name);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  -P workers  worker threads of the parallel run\n");
+  emulator_usage(stderr);
+  exit(1);
+}
+
+static void print_run(int nworkers, const emulator_stats_t *stats, const pdes_stats_t *pstats)
+{
+  printf("%7d %10d %10d %10d %12.1f %10.3f %10ld %10ld %10.3f\n", nworkers,
+         stats->nsim, stats->ndelivered, stats->ntolayer3, stats->time,
+         stats->ndelivered > 0 ? stats->latency_sum / stats->ndelivered : 0.0,
+         stats->nevents, pstats->nwindows, pstats->elapsed);
+}
+
+/* the sum of latencies depends on the order the workers are added in */
+static int same_result(const emulator_stats_t *s, const emulator_stats_t *p)
+{
+  double tolerance = 1e-9 * (s->latency_sum > 1 ? s->latency_sum : 1);
+
+  return s->time == p->time && s->nsim == p->nsim && s->ntolayer3 == p->ntolayer3 &&
+         s->nlost == p->nlost && s->ncorrupt == p->ncorrupt && s->nundetected == p->nundetected &&
+         s->ndelivered == p->ndelivered && s->nduplicate == p->nduplicate &&
+         s->nbad == p->nbad && s->nevents == p->nevents &&
+         s->latency_sum - p->latency_sum < tolerance &&
+         p->latency_sum - s->latency_sum < tolerance;
+}
+
+int main(int argc, char **argv)
+{
+  const protocol_t *protocol = &goback_n_protocol;
+  emulator_params_t params;
+  emulator_stats_t seq_stats, par_stats;
+  pdes_stats_t seq_pstats, par_pstats;
+  int nworkers = sysconf(_SC_NPROCESSORS_ONLN), opt, same;
+
+  emulator_default_params(&params);
+  params.nsimmax = 400000;
+  params.nflows = 1000;
+  params.lambda = 0.05;
+  params.trace = 0;
+  while ((opt = getopt(argc, argv, "p:P:" EMULATOR_OPTIONS)) != -1)
+  {
+    if (opt == 'p')
+    {
+      if ((protocol = find_protocol(optarg)) == NULL)
+        usage(argv[0]);
+    }
+    else if (opt == 'P')
+    {
+      if ((nworkers = atoi(optarg)) < 1)
+        usage(argv[0]);
+    }
+    else if (emulator_option(opt, optarg, &params) != 1)
+      usage(argv[0]);
+  }
+  if (nworkers < 1)
+    nworkers = 1;
+
+  if (pdes_run(protocol, &params, 1, &seq_stats, &seq_pstats) < 0)
+    return 1;
+  printf("%s, %d messages over %d flows, lookahead %.1f\n\n", protocol->name,
+         params.nsimmax, params.nflows, LOOKAHEAD);
+  printf("%7s %10s %10s %10s %12s %10s %10s %10s %10s\n", "workers", "sent",
+         "delivered", "tolayer3", "sim time", "latency", "events", "windows", "wall s");
+  print_run(1, &seq_stats, &seq_pstats);
+  pdes_run(protocol, &params, nworkers, &par_stats, &par_pstats);
+  print_run(nworkers, &par_stats, &par_pstats);
+
+  same = same_result(&seq_stats, &par_stats);
+  printf("\nresults %s, speed-up %.2f\n", same ? "match" : "DIFFER",
+         par_pstats.elapsed > 0 ? seq_pstats.elapsed / par_pstats.elapsed : 0.0);
+  if (seq_stats.drain_stopped)
+    printf("DRAIN FAILED: not drained %g after the last message\n", params.drain_limit);
+  return same && !seq_stats.drain_stopped ? 0 : 1;
+}
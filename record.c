@@ -0,0 +1,183 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "record.h"
+
+#define RECORD_MAGIC "PA2R"
+#define RECORD_VERSION 1
+#define RECORD_BUFFER (1 << 20)
+
+typedef struct record_header_s
+{
+  char magic[4];
+  uint16_t version;
+  uint16_t packet_size; /* sizeof(pkt_t) */
+  uint32_t stats_size;  /* sizeof(emulator_stats_t) */
+  char protocol[RECORD_NAME_SIZE];
+} record_header_t;
+
+#define ENTRY_HEADER 12 /* time, type, entity, reserved */
+
+int record_create(record_writer_t *writer, const char *path, const char *protocol)
+{
+  record_header_t header = {RECORD_MAGIC, RECORD_VERSION, sizeof(pkt_t),
+                            sizeof(emulator_stats_t), ""};
+
+  strncpy(header.protocol, protocol, RECORD_NAME_SIZE - 1);
+  if ((writer->file = fopen(path, "wb")) == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  /* entries are small, so write them out in large blocks */
+  writer->buffer = (char *)malloc(RECORD_BUFFER);
+  setvbuf(writer->file, writer->buffer, _IOFBF, RECORD_BUFFER);
+  fwrite(&header, sizeof(header), 1, writer->file);
+  return 0;
+}
+
+static void write_entry_header(record_writer_t *writer, double time, int type, int entity)
+{
+  char bytes[ENTRY_HEADER] = {0};
+
+  memcpy(bytes, &time, 8);
+  bytes[8] = type;
+  bytes[9] = entity;
+  fwrite(bytes, ENTRY_HEADER, 1, writer->file);
+}
+
+void record_write(record_writer_t *writer, const record_entry_t *entry)
+{
+  write_entry_header(writer, entry->time, entry->type, entry->entity);
+  switch (entry->type)
+  {
+  case RECORD_OUTPUT:
+    fwrite(&entry->flowid, 4, 1, writer->file);
+    fwrite(&entry->n, 4, 1, writer->file);
+    break;
+  case RECORD_INPUT:
+    fwrite(&entry->packet, sizeof(pkt_t), 1, writer->file);
+    break;
+  case RECORD_TIMER:
+    fwrite(&entry->flowid, 4, 1, writer->file);
+    break;
+  }
+}
+
+int record_finish(record_writer_t *writer, const emulator_stats_t *stats)
+{
+  int status;
+
+  write_entry_header(writer, stats->time, RECORD_END, 0);
+  fwrite(stats, sizeof(emulator_stats_t), 1, writer->file);
+  status = ferror(writer->file) | fclose(writer->file);
+  free(writer->buffer);
+  writer->file = NULL;
+  if (status != 0)
+  {
+    perror("record_finish");
+    return -1;
+  }
+  return 0;
+}
+
+int record_open(record_reader_t *reader, const char *path)
+{
+  record_header_t header;
+  struct stat st;
+  int fd;
+
+  reader->map = NULL;
+  if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+  {
+    perror(path);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  if ((size_t)st.st_size >= sizeof(header))
+    reader->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (reader->map == MAP_FAILED || reader->map == NULL)
+  {
+    fprintf(stderr, "%s: not a record log\n", path);
+    reader->map = NULL;
+    return -1;
+  }
+  reader->size = st.st_size;
+  madvise((void *)reader->map, reader->size, MADV_SEQUENTIAL);
+
+  memcpy(&header, reader->map, sizeof(header));
+  if (memcmp(header.magic, RECORD_MAGIC, 4) != 0 || header.version != RECORD_VERSION ||
+      header.packet_size != sizeof(pkt_t) || header.stats_size != sizeof(emulator_stats_t))
+  {
+    fprintf(stderr, "%s: not a record log of this build\n", path);
+    record_close(reader);
+    return -1;
+  }
+  memcpy(reader->protocol, header.protocol, RECORD_NAME_SIZE);
+  reader->protocol[RECORD_NAME_SIZE - 1] = '\0';
+  reader->offset = sizeof(header);
+  return 0;
+}
+
+int record_next(record_reader_t *reader, record_entry_t *entry)
+{
+  const char *p = reader->map + reader->offset;
+  size_t size;
+
+  if (reader->offset + ENTRY_HEADER > reader->size)
+    return -1;
+  memcpy(&entry->time, p, 8);
+  entry->type = p[8];
+  entry->entity = p[9];
+  p += ENTRY_HEADER;
+  switch (entry->type)
+  {
+  case RECORD_OUTPUT:
+    size = 8;
+    break;
+  case RECORD_INPUT:
+    size = sizeof(pkt_t);
+    break;
+  case RECORD_TIMER:
+    size = 4;
+    break;
+  case RECORD_END:
+    size = sizeof(emulator_stats_t);
+    break;
+  default:
+    return -1;
+  }
+  if (reader->offset + ENTRY_HEADER + size > reader->size)
+    return -1;
+  reader->offset += ENTRY_HEADER + size;
+
+  switch (entry->type)
+  {
+  case RECORD_OUTPUT:
+    memcpy(&entry->flowid, p, 4);
+    memcpy(&entry->n, p + 4, 4);
+    return 1;
+  case RECORD_INPUT:
+    memcpy(&entry->packet, p, sizeof(pkt_t));
+    return 1;
+  case RECORD_TIMER:
+    memcpy(&entry->flowid, p, 4);
+    return 1;
+  default:
+    memcpy(&reader->stats, p, sizeof(emulator_stats_t));
+    return 0;
+  }
+}
+
+void record_close(record_reader_t *reader)
+{
+  if (reader->map != NULL)
+    munmap((void *)reader->map, reader->size);
+  reader->map = NULL;
+}
@@ -0,0 +1,67 @@
+#ifndef RECORD_H
+#define RECORD_H
+#include <stddef.h>
+#include <stdio.h>
+#include "emulator.h"
+
+/* ******************************************************************
+ RECORD AND REPLAY LOGS
+
+   A log holds every input the emulator gave the protocol entities of a
+   run, in order: layer 5 messages (by number), packets as they came out
+   of the medium (after loss, corruption and delay) and timer
+   interrupts, each with its simulation time.  Replaying it calls the
+   same routines with the same arguments without the random models, so
+   a protocol behaves bit for bit as it did in the recorded run.
+
+   The file starts with a header (magic, version, sizes and protocol
+   name), then one entry per input: the time as a double, the entry
+   type and entity as two bytes, two reserved bytes and the fields of
+   the type.  A RECORD_END entry with the statistics of the recorded
+   run closes the log.  Entries are in host byte order, so a log is
+   replayed by the build that recorded it.
+**********************************************************************/
+
+#define RECORD_OUTPUT 0 /* flowid, message number */
+#define RECORD_INPUT 1  /* packet */
+#define RECORD_TIMER 2  /* flowid */
+#define RECORD_END 3    /* emulator_stats_t of the run */
+
+#define RECORD_NAME_SIZE 32
+
+typedef struct record_entry_s
+{
+  double time;
+  int type;   /* RECORD_OUTPUT, RECORD_INPUT or RECORD_TIMER */
+  int entity; /* A or B */
+  int flowid; /* for RECORD_OUTPUT and RECORD_TIMER */
+  int n;      /* message number of RECORD_OUTPUT */
+  pkt_t packet; /* packet of RECORD_INPUT */
+} record_entry_t;
+
+typedef struct record_writer_s
+{
+  FILE *file;
+  char *buffer; /* stdio buffer of file */
+} record_writer_t;
+
+typedef struct record_reader_s
+{
+  const char *map; /* mapped log */
+  size_t size;
+  size_t offset;   /* of the next entry */
+  char protocol[RECORD_NAME_SIZE];
+  emulator_stats_t stats; /* of the recorded run, once RECORD_END is read */
+} record_reader_t;
+
+/* these return 0, or -1 after printing why the log can not be used */
+int record_create(record_writer_t *writer, const char *path, const char *protocol);
+void record_write(record_writer_t *writer, const record_entry_t *entry);
+int record_finish(record_writer_t *writer, const emulator_stats_t *stats);
+
+int record_open(record_reader_t *reader, const char *path);
+/* returns 1 and the next entry, 0 at RECORD_END, -1 if the log is cut short */
+int record_next(record_reader_t *reader, record_entry_t *entry);
+void record_close(record_reader_t *reader);
+
+#endif
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "emulator.h"
+#include "protocols.h"
+
+/* replays a log recorded with sim -w and checks that the protocol */
+/* delivers exactly what it delivered in the recorded run          */
+
+static double wall_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-p protocol] [-T level] log\n", prog);
+  fprintf(stderr, "  -p name     protocol the log was recorded with:");
+  for (int i = 0; protocols[i] != NULL; i++)
+    fprintf(stderr, " %s", protocols[i]->name);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  -T level    trace level\n");
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  const protocol_t *protocol = &goback_n_protocol;
+  emulator_stats_t stats, recorded;
+  double start, elapsed;
+  int opt, same;
+
+  TRACE = 0;
+  while ((opt = getopt(argc, argv, "p:T:")) != -1)
+  {
+    if (opt == 'p' && (protocol = find_protocol(optarg)) != NULL)
+      continue;
+    if (opt == 'T')
+      TRACE = atoi(optarg);
+    else
+      usage(argv[0]);
+  }
+  if (optind != argc - 1)
+    usage(argv[0]);
+
+  start = wall_clock();
+  if (emulator_replay(protocol, argv[optind], &stats, &recorded) < 0)
+    return 1;
+  elapsed = wall_clock() - start;
+
+  printf("%-9s %9s %9s %9s %9s %13s %11s\n", "", "sent", "delivered", "dup",
+         "tolayer3", "latency sum", "events");
+  printf("%-9s %9d %9d %9d %9d %13.3f %11ld\n", "recorded", recorded.nsim,
+         recorded.ndelivered, recorded.nduplicate, recorded.ntolayer3,
+         recorded.latency_sum, recorded.nevents);
+  printf("%-9s %9d %9d %9d %9d %13.3f %11ld\n", "replayed", stats.nsim, stats.ndelivered,
+         stats.nduplicate, stats.ntolayer3, stats.latency_sum, stats.nevents);
+
+  /* the latency sums add the same doubles in the same order */
+  same = stats.nsim == recorded.nsim && stats.ndelivered == recorded.ndelivered &&
+         stats.nduplicate == recorded.nduplicate && stats.nbad == recorded.nbad &&
+         stats.ntolayer3 == recorded.ntolayer3 && stats.nevents == recorded.nevents &&
+         stats.latency_sum == recorded.latency_sum;
+  printf("\nreplay %s, %ld events in %.3f s (%.0f per second)\n",
+         same ? "matches" : "DIFFERS", stats.nevents, elapsed,
+         elapsed > 0 ? stats.nevents / elapsed : 0.0);
+  return emulator_close() == 0 && same ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sampler.h"
+
+#define SAMPLER_BUFFER (1 << 20)
+
+int sampler_open(sampler_t *sampler, const char *path, double interval)
+{
+  size_t len = strlen(path);
+  uint32_t columns = SAMPLE_COLUMNS;
+
+  if ((sampler->file = fopen(path, "wb")) == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  sampler->buffer = (char *)malloc(SAMPLER_BUFFER);
+  setvbuf(sampler->file, sampler->buffer, _IOFBF, SAMPLER_BUFFER);
+  sampler->binary = len > 4 && strcmp(path + len - 4, ".bin") == 0;
+  sampler->interval = interval;
+  sampler->next = interval;
+  sampler->last_bytes = sampler->last_retransmissions = 0;
+
+  if (sampler->binary)
+  {
+    fwrite("PA2S", 4, 1, sampler->file);
+    fwrite(&columns, sizeof(columns), 1, sampler->file);
+  }
+  else
+    fprintf(sampler->file, "time,in_transit,window,bytes_delivered,retransmissions,"
+                           "pending_events,in_medium\n");
+  return 0;
+}
+
+void sampler_write(sampler_t *sampler, sample_t *sample)
+{
+  double row[SAMPLE_COLUMNS];
+  long bytes = sample->bytes_delivered, retransmissions = sample->retransmissions;
+
+  sample->bytes_delivered -= sampler->last_bytes;
+  sample->retransmissions -= sampler->last_retransmissions;
+  sampler->last_bytes = bytes;
+  sampler->last_retransmissions = retransmissions;
+  sampler->next += sampler->interval;
+
+  if (sampler->binary)
+  {
+    row[0] = sample->time;
+    row[1] = sample->in_transit;
+    row[2] = sample->window;
+    row[3] = sample->bytes_delivered;
+    row[4] = sample->retransmissions;
+    row[5] = sample->pending_events;
+    row[6] = sample->in_medium;
+    fwrite(row, sizeof(row), 1, sampler->file);
+  }
+  else
+    fprintf(sampler->file, "%.3f,%ld,%ld,%ld,%ld,%ld,%ld\n", sample->time, sample->in_transit,
+            sample->window, sample->bytes_delivered, sample->retransmissions,
+            sample->pending_events, sample->in_medium);
+}
+
+int sampler_close(sampler_t *sampler)
+{
+  int status = ferror(sampler->file) | fclose(sampler->file);
+
+  free(sampler->buffer);
+  sampler->file = NULL;
+  if (status != 0)
+  {
+    perror("sampler_close");
+    return -1;
+  }
+  return 0;
+}
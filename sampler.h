@@ -0,0 +1,49 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+#include <stdio.h>
+#include "emulator.h"
+
+/* ******************************************************************
+ TIME SERIES SAMPLER
+
+   Writes one row every emulator_params_t.sample_interval of simulation
+   time.  The emulator takes the rows due before each event it
+   simulates, so sampling adds no events and costs a comparison per
+   event plus a row per interval, whatever the number of flows.  Rows
+   go through a large stdio buffer to a CSV file, or to a binary file if
+   the name ends in ".bin": a "PA2S" magic, the number of columns as a
+   uint32 and then every row as that many doubles, in host byte order.
+**********************************************************************/
+
+#define SAMPLE_COLUMNS 7
+
+typedef struct sample_s
+{
+  double time;            /* end of the interval */
+  long in_transit;        /* packets sent by the protocol and not ACKed */
+  long window;            /* packets or messages held by the senders */
+  long bytes_delivered;   /* passed to layer 5 during the interval */
+  long retransmissions;   /* during the interval */
+  long pending_events;    /* in the event list */
+  long in_medium;         /* packets on their way through the medium */
+} sample_t;
+
+typedef struct sampler_s
+{
+  FILE *file;
+  char *buffer;   /* stdio buffer of file */
+  int binary;
+  double interval;
+  double next;    /* time of the next row */
+  long last_bytes; /* totals at the previous row */
+  long last_retransmissions;
+} sampler_t;
+
+/* returns 0, or -1 after printing why path can not be written */
+int sampler_open(sampler_t *sampler, const char *path, double interval);
+/* writes the row of sample, whose totals are since the start of the */
+/* run, and moves on to the next interval                            */
+void sampler_write(sampler_t *sampler, sample_t *sample);
+int sampler_close(sampler_t *sampler);
+
+#endif
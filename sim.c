@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "emulator.h"
+#include "latency.h"
+#include "options.h"
+#include "profile.h"
+#include "topology.h"
+#include "protocols.h"
+
+/* runs a single protocol through the emulator and prints its statistics */
+
+static double wall_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_link(const char *name, const link_stats_t *link, double time)
+{
+  char label[48];
+
+  snprintf(label, sizeof(label), "link %s:", name);
+  printf("%-20s %ld packets, %ld dropped (%ld early), %.1f%% busy\n", label,
+         link->npackets, link->ndropped + link->nearly, link->nearly,
+         time > 0 ? 100 * link->busy_time / time : 0.0);
+  printf("                     queue %.2f average, %d peak; delay %.3f average, %.3f max\n",
+         time > 0 ? link->queue_area / time : 0.0, link->peak_queue,
+         link->npackets > 0 ? link->delay_sum / link->npackets : 0.0, link->max_delay);
+  if (link->nmarked > 0)
+    printf("                     %ld marked ECN congestion experienced\n", link->nmarked);
+}
+
+static void print_topology(const topology_t *topology, double time)
+{
+  char name[2 * TOPOLOGY_NAME_SIZE + 2], label[2 * TOPOLOGY_NAME_SIZE + 8];
+
+  for (int i = 0; i < topology->nlinks; i++)
+  {
+    const topology_link_t *link = &topology->links[i];
+
+    snprintf(name, sizeof(name), "%s->%s", topology->names[link->from],
+             topology->names[link->to]);
+    if (link->params.bandwidth > 0)
+      print_link(name, &link->stats, time);
+    else
+    {
+      snprintf(label, sizeof(label), "link %s:", name);
+      printf("%-20s %ld packets, no serialization\n", label, link->stats.npackets);
+    }
+    printf("                     %ld lost, %ld corrupted\n", link->nlost, link->ncorrupt);
+  }
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-p protocol] [options]\n", prog);
+  fprintf(stderr, "  -p name     protocol to run:");
+  for (int i = 0; protocols[i] != NULL; i++)
+    fprintf(stderr, " %s", protocols[i]->name);
+  fprintf(stderr, "\n");
+  emulator_usage(stderr);
+  exit(1);
+}
+
+static void print_drain(const emulator_stats_t *stats)
+{
+  const flow_stats_t *flows;
+  double fct = 0, recovery = 0;
+  int i, n = emulator_flows(&flows), completed = 0, incomplete = 0;
+
+  for (i = 0; i < n; i++)
+    if (flows[i].nmsgs > 0 && flows[i].ndelivered == flows[i].nmsgs)
+    {
+      completed++;
+      fct += flows[i].completion - flows[i].start;
+      recovery += flows[i].recovery;
+    }
+  if (stats->drain_stopped)
+    printf("DRAIN FAILED:        not drained at the limit, %f, %f after the last message\n",
+           stats->time, stats->time - stats->drain_start);
+  else
+    printf("drained:             at %f, %f after the last message\n", stats->time,
+           stats->time - stats->drain_start);
+  if (completed > 0)
+    printf("flow completion:     %d flows, %f on average, %.1f%% in loss recovery\n", completed,
+           fct / completed, fct > 0 ? 100 * recovery / fct : 0.0);
+  for (i = 0; i < n; i++)
+    if (flows[i].ndelivered < flows[i].nmsgs && incomplete++ < 10)
+      printf("incomplete flow:     %c flow %d, %d of %d msgs delivered\n",
+             flows[i].entity == A ? 'A' : 'B', flows[i].flowid, flows[i].ndelivered,
+             flows[i].nmsgs);
+  if (incomplete > 10)
+    printf("incomplete flows:    %d more\n", incomplete - 10);
+}
+
+int main(int argc, char **argv)
+{
+  const protocol_t *protocol = &goback_n_protocol;
+  emulator_params_t params;
+  emulator_stats_t stats;
+  const profile_t *profile;
+  const topology_t *topology;
+  double start, elapsed;
+  int opt;
+
+  emulator_default_params(&params);
+  while ((opt = getopt(argc, argv, "p:" EMULATOR_OPTIONS)) != -1)
+  {
+    if (opt == 'p')
+    {
+      if ((protocol = find_protocol(optarg)) == NULL)
+        usage(argv[0]);
+    }
+    else if (emulator_option(opt, optarg, &params) != 1)
+      usage(argv[0]);
+  }
+
+  printf("-----  %s Network Simulator Version 1.1 -------- \n\n", protocol->name);
+  printf("messages to simulate: %d\n", params.nsimmax);
+  printf("packet loss probability: %f\n", params.lossprob);
+  printf("packet corruption probability: %f\n", params.corruptprob);
+  printf("average time between messages from sender's layer5: %f\n", params.lambda);
+  printf("concurrent flows: %d\n", params.nflows);
+  if (params.topology != NULL)
+    printf("topology: %s\n", params.topology);
+  else if (params.bandwidth > 0)
+    printf("link: %f bytes per time unit, %f propagation delay, %d packet %s buffer\n",
+           params.bandwidth, params.propdelay, params.queue_limit,
+           params.queue_policy == QUEUE_RED ? "RED" : "drop-tail");
+  if (params.loss_model == LOSS_GILBERT)
+    printf("Gilbert-Elliott loss: p %f, r %f, %f good, %f bad\n", params.ge_p, params.ge_r,
+           params.ge_loss_good, params.ge_loss_bad);
+  else if (params.loss_model == LOSS_TRACE)
+    printf("loss trace: %s\n", params.loss_trace);
+  if (params.arrival[A] != ARRIVAL_UNIFORM || params.arrival[B] != ARRIVAL_UNIFORM)
+    printf("arrivals: %s from A, %s from B\n", arrival_names[params.arrival[A]],
+           arrival_names[params.bidirectional ? params.arrival[B] : ARRIVAL_NONE]);
+  if (params.rcvbuf > 0)
+    printf("receive buffer: %d messages, read at %f per time unit\n", params.rcvbuf,
+           params.read_rate);
+  printf("TRACE: %d\n", params.trace);
+
+  start = wall_clock();
+  if (emulator_run(protocol, &params, &stats) < 0)
+    return 1;
+  elapsed = wall_clock() - start;
+
+  printf("\n");
+  printf("sent to layer3:      %d (%d lost, %d corrupted)\n",
+         stats.ntolayer3, stats.nlost, stats.ncorrupt);
+  if (stats.ncorrupt > 0)
+    printf("corruption:          %ld bit errors, %d corrupted packets undetected\n",
+           stats.nbit_errors, stats.nundetected);
+  for (int i = A; i <= B; i++)
+    if (stats.nbursts[i] > 0)
+      printf("bursts %s:         %ld, %.2f packets on average, %d at most\n",
+             i == A ? "A->B" : "B->A", stats.nbursts[i],
+             (double)stats.nsent[i] / stats.nbursts[i], stats.max_burst[i]);
+  if (stats.nlost > 0)
+    printf("loss bursts:         %d, longest %d\n", stats.nloss_bursts, stats.max_loss_burst);
+  printf("delivered to layer5: %d of %d (%d duplicated, %d bad)\n",
+         stats.ndelivered, stats.nsim, stats.nduplicate, stats.nbad);
+  if (stats.nunstamped > 0)
+    printf("unstamped:           %d more delivered too late to time\n", stats.nunstamped);
+  if (stats.ndelivered > 0)
+  {
+    printf("average latency:     %f\n", stats.latency_sum / stats.ndelivered);
+    printf("latency percentiles: %f p50, %f p99, %f p99.9, %f max\n",
+           latency_percentile(&stats.latency, 50), latency_percentile(&stats.latency, 99),
+           latency_percentile(&stats.latency, 99.9), stats.latency.max);
+  }
+  if (stats.medium_queueing > 0)
+    printf("medium queueing:     %f per packet behind those ahead of it\n",
+           stats.medium_queueing / (stats.ntolayer3 - stats.nlost));
+  if (params.drain)
+    print_drain(&stats);
+  if (params.rcvbuf > 0)
+    printf("throughput:          %f messages per time unit, %d dropped by full buffers\n",
+           stats.time > 0 ? stats.ndelivered / stats.time : 0.0, stats.nrcvbuf_full);
+  printf("events:              %ld in %.3f s (%.0f per second), %d pending at peak\n",
+         stats.nevents, elapsed, elapsed > 0 ? stats.nevents / elapsed : 0.0,
+         stats.peak_events);
+  printf("timer table:         %zu bytes (%.1f per flow)\n", stats.timer_bytes,
+         (double)stats.timer_bytes / params.nflows);
+  printf("memory (peak):       %zu (%zu) events, %zu (%zu) channel, %zu (%zu) window bytes\n",
+         stats.memory[MEMORY_EVENTS].current, stats.memory[MEMORY_EVENTS].peak,
+         stats.memory[MEMORY_CHANNEL].current, stats.memory[MEMORY_CHANNEL].peak,
+         stats.memory[MEMORY_WINDOW].current, stats.memory[MEMORY_WINDOW].peak);
+  printf("peak memory:         %zu bytes (%.1f per flow)\n", stats.peak_memory,
+         (double)stats.peak_memory / params.nflows);
+  if (emulator_topology(&topology))
+    print_topology(topology, stats.time);
+  else if (params.bandwidth > 0)
+    for (int i = A; i <= B; i++)
+      print_link(i == A ? "A->B" : "B->A", &stats.link[i], stats.time);
+  if (emulator_profile(&profile))
+    profile_print(stdout, profile);
+  if (protocol->report != NULL)
+    protocol->report();
+  return emulator_close() < 0 || stats.drain_stopped ? 1 : 0;
+}
@@ -1,48 +1,25 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "connection.h"
+#include "conntable.h"
+#include "emulator.h"
+#include "packet.h"
+#include "protocols.h"
 /* ******************************************************************
- ALTERNATING BIT AND GO-BACK-N NETWORK EMULATOR: VERSION 1.1  J.F.Kurose
-
-   This code should be used for PA2, unidirectional or bidirectional
-   data transfer protocols (from A to B. Bidirectional transfer of data
-   is for extra credit and is not required).  Network properties:
-   - one way network delay averages five time units (longer if there
-     are other messages in the channel for GBN), but can be larger
-   - packets can be corrupted (either the header or the data portion)
-     or lost, according to user-defined probabilities
-   - packets will be delivered in the order in which they were sent
-     (although some can be lost).
+ ALTERNATING BIT PROTOCOL
+
+   Transport protocol entities A and B, run by the network emulator in
+   emulator.c through alt_bit_protocol.
+
+   With a handshake_mode(), a sender opens a connection, see
+   connection.h, when it is given a message with none open, and closes
+   it once its send queue is empty.  The SYN and the FIN are held as
+   the packet in transit, which the timer sends again.  The data of a
+   connection alternates from bit (ISN + 1) & 1; the SYN-ACK ACKs the
+   ISN + 2 if the SYN carried the first message and layer 5 took it,
+   the ISN + 1 otherwise.
 **********************************************************************/
 
-#define BIDIRECTIONAL 1 /* change to 1 if you're doing extra credit */
-                        /* and write a routine called B_output */
-
-#define A 0
-#define B 1
-
-/* a "msg" is the data unit passed from layer 5 (teachers code) to layer  */
-/* 4 (students' code).  It contains the data (characters) to be delivered */
-/* to layer 5 via the students transport level protocol entities.         */
-typedef struct msg
-{
-  char data[20];
-} msg_t;
-
-/* a packet is the data unit passed from layer 4 (students code) to layer */
-/* 3 (teachers code).  Note the pre-defined packet structure, which all   */
-/* students must follow. */
-typedef struct pkt
-{
-  int seqnum;
-  int acknum;
-  int checksum;
-  char payload[20];
-} pkt_t;
-
-void tolayer3(int AorB, pkt_t packet);
-void tolayer5(int AorB, char *data);
-void stoptimer(int);
-void starttimer(int, float);
 /********* STUDENTS WRITE THE NEXT SEVEN ROUTINES *********/
 
 #define S_WAITING_DATA_0 0
@@ -50,696 +27,478 @@ void starttimer(int, float);
 #define S_WAITING_DATA_1 2
 #define S_WAITING_ACK_1 3
 
+#define SEND_QUEUE_SIZE 64 /* messages waiting for the packet in transit */
+#define TIMEOUT 200        /* unless retransmit_timeout() sets it */
+
+typedef struct queued_msg_s
+{
+  msg_t message;
+  struct queued_msg_s *next;
+} queued_msg_t;
+
 typedef struct caller_state_s
 {
   pkt_t *pkt_in_transit;
   int state;
   int last_acked;
-  int timeout;
+  float timeout;
   int id;
+  int flowid;
+
+  queued_msg_t *queue_head; /* send queue, drained on each ACK */
+  queued_msg_t *queue_tail;
+  int queue_len;
+
+  int nqueued;   /* messages that had to wait in send_queue */
+  int ndropped;  /* messages dropped because send_queue was full */
+  int max_queue; /* send_queue high-water mark */
+  int nrefused;  /* messages refused because the receive buffer was full */
+
+  connection_t connection; /* of the data sent and of the data received */
 } caller_state_t;
 
-caller_state_t a;
-caller_state_t b;
+/* caller_state_t of every flow, by entity.  Per thread, as the parallel */
+/* engine runs the flows of each partition on its own worker.            */
+static __thread conn_table_t connections[2];
+static __thread protocol_sample_t totals[2]; /* of the flows of each entity */
+static __thread int handshake;               /* handshake_mode() of the run */
 
-void get_buffer_from_packet(pkt_t *packet, char *buffer)
+static pkt_t *get_ack_pkt(pkt_t *packet, pkt_t *received_pkt, int seqnum)
 {
-  // Loads seqnum to buffer
-  char *tmp_buffer = buffer;
-  *(tmp_buffer + 0) = (packet->seqnum >> 0);
-  *(tmp_buffer + 1) = (packet->seqnum >> 8);
-  *(tmp_buffer + 2) = (packet->seqnum >> 16);
-  *(tmp_buffer + 3) = (packet->seqnum >> 24);
-
-  // Loads acknum to buffer
-  tmp_buffer = buffer + 4;
-  *(tmp_buffer + 0) = (packet->acknum >> 0);
-  *(tmp_buffer + 1) = (packet->acknum >> 8);
-  *(tmp_buffer + 2) = (packet->acknum >> 16);
-  *(tmp_buffer + 3) = (packet->acknum >> 24);
-
-  // Loads payload to buffer
-  tmp_buffer = buffer + 8;
-  for (int i = 0; i < 20; i++)
+  packet->flowid = received_pkt->flowid;
+  packet->seqnum = seqnum;
+  packet->acknum = received_pkt->seqnum;
+
+  packet->payload[0] = 'A';
+  packet->payload[1] = 'C';
+  packet->payload[2] = 'K';
+  packet->payload[3] = '\0';
+
+  for (int i = 4; i < 20; i++)
   {
-    tmp_buffer[i] = packet->payload[i];
+    packet->payload[i] = 0;
   }
+
+  packet->checksum = get_checksum(packet);
+  packet->ecn = ECN_NOT_ECT;
+
+  return packet;
 }
 
-int get_checksum_from_buffer(char *buffer, size_t size)
+static void send_msg(caller_state_t *caller, msg_t *message)
 {
-  unsigned int cksum = 0;
-  while (size > 1)
+  switch (caller->state)
   {
-    cksum += *((unsigned short *)(buffer + 1));
-    size -= 2;
-    buffer += 2;
+  case S_WAITING_DATA_0:
+    caller->pkt_in_transit = get_pkt_from_msg(message, caller->flowid, 0, caller->last_acked);
+    totals[caller->id].in_transit++;
+    totals[caller->id].window++;
+    caller->state = S_WAITING_ACK_0;
+    tolayer3(caller->id, *(caller->pkt_in_transit));
+    starttimer(caller->id, caller->flowid, caller->timeout);
+    break;
+  case S_WAITING_DATA_1:
+    caller->pkt_in_transit = get_pkt_from_msg(message, caller->flowid, 1, caller->last_acked);
+    totals[caller->id].in_transit++;
+    totals[caller->id].window++;
+    caller->state = S_WAITING_ACK_1;
+    tolayer3(caller->id, *(caller->pkt_in_transit));
+    starttimer(caller->id, caller->flowid, caller->timeout);
+    break;
+  default:
+    break;
   }
-  if (size)
-    cksum += (unsigned short)(0x00FF & *buffer);
-
-  cksum = (~cksum & 0xffff);
-  return cksum;
 }
 
-int get_checksum(pkt_t *packet)
+/* sends the oldest queued message, once the previous one has been ACKed */
+static void send_queued(caller_state_t *caller)
 {
-  char buffer[sizeof(pkt_t)] = {0x0};
-
-  get_buffer_from_packet(packet, buffer);
-
-  int checksum = get_checksum_from_buffer(buffer, 20);
-
-  return checksum;
+  queued_msg_t *queued = caller->queue_head;
+  if (queued == NULL)
+    return;
+  caller->queue_head = queued->next;
+  if (caller->queue_head == NULL)
+    caller->queue_tail = NULL;
+  caller->queue_len--;
+  totals[caller->id].window--;
+  send_msg(caller, &queued->message);
+  memory_free(MEMORY_WINDOW, queued, sizeof(queued_msg_t));
 }
 
-int is_corrupted(pkt_t *packet)
+/* sends a SYN or FIN as the packet in transit */
+static void send_control(caller_state_t *caller, pkt_t *packet)
 {
-  int checksum = get_checksum(packet);
-  return checksum != packet->checksum;
+  caller->pkt_in_transit = (pkt_t *)memory_alloc(MEMORY_WINDOW, sizeof(pkt_t));
+  *caller->pkt_in_transit = *packet;
+  tolayer3(caller->id, *packet);
+  starttimer(caller->id, caller->flowid, caller->timeout);
 }
 
-pkt_t *get_pkt_from_msg(msg_t *msg, int sequence, int acknum)
+/* opens a connection for the messages queued, with a SYN that carries */
+/* the first with HANDSHAKE_FASTOPEN                                   */
+static void open_connection(caller_state_t *caller)
 {
-  pkt_t *packet = (pkt_t *)malloc(sizeof(pkt_t));
+  pkt_t syn;
+
+  connection_open(&caller->connection, caller->id, caller->flowid, current_time());
+  connection_syn(&caller->connection, &syn, caller->flowid,
+                 handshake == HANDSHAKE_FASTOPEN ? caller->queue_head->message.data : NULL);
+  send_control(caller, &syn);
+}
 
-  packet->seqnum = sequence;
-  packet->acknum = acknum;
+/* the SYN-ACK came back: the data starts from bit (ISN + 1) & 1, after */
+/* the message the SYN carried if layer 5 took it                       */
+static void established(caller_state_t *caller, pkt_t *syn_ack)
+{
+  int bit = (caller->connection.isn + 1) & 1;
+  queued_msg_t *queued;
+  pkt_t ack;
 
-  for (int i = 0; i < 20; i++)
+  stoptimer(caller->id, caller->flowid);
+  memory_free(MEMORY_WINDOW, caller->pkt_in_transit, sizeof(pkt_t));
+  caller->pkt_in_transit = NULL;
+  connection_established(&caller->connection, syn_ack, &ack);
+  tolayer3(caller->id, ack);
+  if (syn_ack->acknum == caller->connection.isn + 2)
   {
-    packet->payload[i] = msg->data[i];
+    queued = caller->queue_head;
+    caller->queue_head = queued->next;
+    if (caller->queue_head == NULL)
+      caller->queue_tail = NULL;
+    caller->queue_len--;
+    totals[caller->id].window--;
+    memory_free(MEMORY_WINDOW, queued, sizeof(queued_msg_t));
+    bit = !bit;
   }
+  caller->state = bit ? S_WAITING_DATA_1 : S_WAITING_DATA_0;
+}
 
-  packet->checksum = get_checksum(packet);
+/* the send queue is empty: closes the connection with a FIN */
+static void close_connection(caller_state_t *caller)
+{
+  pkt_t fin;
 
-  return packet;
+  connection_fin(&caller->connection, &fin, caller->flowid, caller->connection.isn);
+  send_control(caller, &fin);
 }
 
-pkt_t *get_ack_pkt(pkt_t *packet, pkt_t *received_pkt, int seqnum)
+/* an ACK while the SYN or the FIN is in transit */
+static void handshake_acked(caller_state_t *caller, pkt_t *packet)
 {
-  packet->seqnum = seqnum;
-  packet->acknum = received_pkt->seqnum;
-  packet->payload;
+  connection_t *connection = &caller->connection;
 
-  packet->payload[0] = 'A';
-  packet->payload[1] = 'C';
-  packet->payload[2] = 'K';
-  packet->payload[3] = '\0';
-
-  for (int i = 4; i < 20; i++)
+  if (connection->state == CONNECTION_SYN_SENT && packet->payload[11] == CONNECTION_SYN_ACK &&
+      (packet->acknum == connection->isn + 1 ||
+       (packet->acknum == connection->isn + 2 && handshake == HANDSHAKE_FASTOPEN)))
   {
-    packet->payload[i] = 0;
+    established(caller, packet);
+    send_queued(caller);
   }
-
-  packet->checksum = get_checksum(packet);
-
-  return packet;
+  else if (connection_fin_acked(connection, packet))
+  {
+    stoptimer(caller->id, caller->flowid);
+    memory_free(MEMORY_WINDOW, caller->pkt_in_transit, sizeof(pkt_t));
+    caller->pkt_in_transit = NULL;
+    connection_close(connection, current_time());
+    if (caller->queue_head != NULL)
+      open_connection(caller);
+    return;
+  }
+  else
+    return;
+  if (caller->pkt_in_transit == NULL)
+    close_connection(caller); /* the SYN carried the only message */
 }
 
-int is_ack_packet(pkt_t *packet)
+/* a SYN, the ACK of a SYN-ACK or a FIN from the peer */
+static void handshake_input(caller_state_t *caller, pkt_t *packet)
 {
-  return packet->payload[0] == 'A' &&
-         packet->payload[1] == 'C' &&
-         packet->payload[2] == 'K';
-}
+  connection_t *connection = &caller->connection;
+  int bit = (packet->seqnum + 1) & 1;
+  pkt_t ack;
 
-void handle_output(caller_state_t *caller, msg_t *message)
-{
-  switch (caller->state)
+  switch (packet->acknum)
   {
-  case S_WAITING_DATA_0:
-    caller->pkt_in_transit = get_pkt_from_msg(message, 0, caller->last_acked);
-    caller->state = S_WAITING_ACK_0;
-    tolayer3(caller->id, *(caller->pkt_in_transit));
-    starttimer(caller->id, caller->timeout);
+  case CONNECTION_SYN:
+  case CONNECTION_SYN_DATA:
+    if (connection_accept(connection, caller->id, packet))
+    {
+      caller->last_acked = !bit; /* the first data is new */
+      if (packet->acknum == CONNECTION_SYN_DATA &&
+          layer5_window(caller->id, caller->flowid) != 0)
+      {
+        tolayer5(caller->id, caller->flowid, packet->payload);
+        connection_delivered(connection, current_time());
+        caller->last_acked = bit;
+      }
+    }
+    get_ack_pkt(&ack, packet, 0);
+    /* the message the SYN carried counts as data bit */
+    ack.acknum = packet->seqnum + (caller->last_acked == bit ? 2 : 1);
+    connection_mark(connection, &ack, CONNECTION_SYN_ACK);
+    tolayer3(caller->id, ack);
     break;
-  case S_WAITING_DATA_1:
-    caller->pkt_in_transit = get_pkt_from_msg(message, 1, caller->last_acked);
-    caller->state = S_WAITING_ACK_1;
-    tolayer3(caller->id, *(caller->pkt_in_transit));
-    starttimer(caller->id, caller->timeout);
+  case CONNECTION_ACK:
+    connection_confirm(connection, packet);
     break;
-  default:
+  case CONNECTION_FIN:
+    if (connection->peer_state != CONNECTION_LISTEN && packet->seqnum != connection->peer_isn)
+      break; /* of an earlier connection */
+    connection->peer_state = CONNECTION_LISTEN;
+    get_ack_pkt(&ack, packet, 0);
+    ack.acknum = packet->seqnum + 1;
+    connection_mark(connection, &ack, CONNECTION_FIN_ACK);
+    tolayer3(caller->id, ack);
     break;
   }
 }
 
-void handle_input(caller_state_t *caller, pkt_t *packet)
+static void handle_output(caller_state_t *caller, msg_t *message)
+{
+  if (caller->connection.state == CONNECTION_ESTABLISHED &&
+      (caller->state == S_WAITING_DATA_0 || caller->state == S_WAITING_DATA_1) &&
+      caller->queue_len == 0)
+  {
+    send_msg(caller, message);
+    return;
+  }
+
+  if (caller->queue_len == SEND_QUEUE_SIZE)
+  {
+    caller->ndropped++;
+    return;
+  }
+  queued_msg_t *queued = (queued_msg_t *)memory_alloc(MEMORY_WINDOW, sizeof(queued_msg_t));
+  queued->message = *message;
+  queued->next = NULL;
+  if (caller->queue_tail == NULL)
+    caller->queue_head = queued;
+  else
+    caller->queue_tail->next = queued;
+  caller->queue_tail = queued;
+  caller->queue_len++;
+  totals[caller->id].window++;
+  caller->nqueued++;
+  if (caller->queue_len > caller->max_queue)
+    caller->max_queue = caller->queue_len;
+  if (caller->connection.state == CONNECTION_CLOSED)
+    open_connection(caller);
+}
+
+static void handle_input(caller_state_t *caller, pkt_t *packet)
 {
   if (!is_corrupted(packet))
   {
-    if (!is_ack_packet(packet))
+    if (CONNECTION_CONTROL(packet->acknum))
+    {
+      if (handshake != HANDSHAKE_NONE)
+        handshake_input(caller, packet);
+    }
+    else if (!is_ack_packet(packet))
     {
+      if (caller->connection.peer_state == CONNECTION_LISTEN)
+        return; /* data of a connection not open */
+      connection_confirm(&caller->connection, packet);
       if (packet->seqnum != caller->last_acked)
       {
-        tolayer5(caller->id, packet->payload);
+        /* stop-and-wait needs no advertised window: a new message that */
+        /* finds the receive buffer full goes unACKed and is resent     */
+        if (layer5_window(caller->id, caller->flowid) == 0)
+        {
+          caller->nrefused++;
+          return;
+        }
+        tolayer5(caller->id, caller->flowid, packet->payload);
+        connection_delivered(&caller->connection, current_time());
       }
 
       pkt_t ack_packet;
       get_ack_pkt(&ack_packet, packet, 0);
+      if (handshake != HANDSHAKE_NONE)
+        connection_mark(&caller->connection, &ack_packet, 0);
       tolayer3(caller->id, ack_packet);
       caller->last_acked = packet->seqnum;
     }
+    else if (caller->connection.state != CONNECTION_ESTABLISHED || packet->payload[11] != 0)
+    {
+      handshake_acked(caller, packet);
+    }
     else
     {
+      if (handshake != HANDSHAKE_NONE)
+        connection_acked(&caller->connection, packet);
       switch (caller->state)
       {
       case S_WAITING_ACK_0:
         if (packet->acknum == 0)
         {
-          free(caller->pkt_in_transit);
+          memory_free(MEMORY_WINDOW, caller->pkt_in_transit, sizeof(pkt_t));
           caller->pkt_in_transit = NULL;
+          totals[caller->id].in_transit--;
+          totals[caller->id].window--;
           caller->state = S_WAITING_DATA_1;
-          stoptimer(caller->id);
+          stoptimer(caller->id, caller->flowid);
+          send_queued(caller);
         }
         break;
       case S_WAITING_ACK_1:
         if (packet->acknum == 1)
         {
-          free(caller->pkt_in_transit);
+          memory_free(MEMORY_WINDOW, caller->pkt_in_transit, sizeof(pkt_t));
           caller->pkt_in_transit = NULL;
+          totals[caller->id].in_transit--;
+          totals[caller->id].window--;
           caller->state = S_WAITING_DATA_0;
-          stoptimer(caller->id);
+          stoptimer(caller->id, caller->flowid);
+          send_queued(caller);
         }
         break;
       default:
         break;
       }
+      if (handshake != HANDSHAKE_NONE && caller->pkt_in_transit == NULL)
+        close_connection(caller);
     }
   }
   else
   {
-    printf("Corrupted packet arrive %d\n", caller->id);
+    if (TRACE > 0)
+      printf("Corrupted packet arrive %d\n", caller->id);
   }
 }
 
-void handle_timerinterrupt(caller_state_t *caller)
+static void handle_timerinterrupt(caller_state_t *caller)
 {
   if (caller->pkt_in_transit != NULL)
   {
     tolayer3(caller->id, *caller->pkt_in_transit);
-    starttimer(caller->id, caller->timeout);
+    if (caller->connection.state == CONNECTION_SYN_SENT)
+      caller->connection.nsyn++;
+    else if (caller->connection.state == CONNECTION_FIN_SENT)
+      caller->connection.nfin++;
+    else
+      totals[caller->id].retransmissions++;
+    starttimer(caller->id, caller->flowid, caller->timeout);
   }
 }
 
-/* called from layer 5, passed the data to be sent to other side */
-void A_output(msg_t message)
-{
-  handle_output(&a, &message);
-  return;
+/* returns the state of flowid at entity AorB, opening the flow the */
+/* first time it is seen                                             */
+static caller_state_t *get_caller(int AorB, int flowid)
+{
+  caller_state_t *caller = conn_table_get(&connections[AorB], flowid);
+  if (caller != NULL)
+    return caller;
+
+  caller = (caller_state_t *)malloc(sizeof(caller_state_t));
+  caller->id = AorB;
+  caller->flowid = flowid;
+  caller->pkt_in_transit = NULL;
+  caller->state = S_WAITING_DATA_0;
+  caller->last_acked = -1;
+  caller->timeout = retransmit_timeout() > 0 ? retransmit_timeout() : TIMEOUT;
+  caller->queue_head = NULL;
+  caller->queue_tail = NULL;
+  caller->queue_len = 0;
+  caller->nqueued = 0;
+  caller->ndropped = 0;
+  caller->max_queue = 0;
+  caller->nrefused = 0;
+  connection_init(&caller->connection, handshake);
+  conn_table_put(&connections[AorB], flowid, caller);
+  return caller;
 }
 
-void B_output(msg_t message) /* need be completed only for extra credit */
+static void destroy_caller(void *state)
 {
-  handle_output(&b, &message);
-  return;
-}
-
-/* called from layer 3, when a packet arrives for layer 4 */
-void A_input(pkt_t packet)
-{
-  handle_input(&a, &packet);
-  return;
-}
-
-/* called when A's timer goes off */
-void A_timerinterrupt()
-{
-  handle_timerinterrupt(&a);
-  return;
-}
-
-/* the following routine will be called once (only) before any other */
-/* entity A routines are called. You can use it to do any initialization */
-void A_init()
-{
-  a.id = A;
-  a.pkt_in_transit = NULL;
-  a.state = S_WAITING_DATA_0;
-  a.last_acked = -1;
-  a.timeout = 200;
-  return;
-}
-
-/* Note that with simplex transfer from a-to-B, there is no B_output() */
-
-/* called from layer 3, when a packet arrives for layer 4 at B*/
-void B_input(pkt_t packet)
-{
-  handle_input(&b, &packet);
-  return;
-}
-
-/* called when B's timer goes off */
-void B_timerinterrupt()
-{
-  handle_timerinterrupt(&b);
-  return;
-}
-
-/* the following rouytine will be called once (only) before any other */
-/* entity B routines are called. You can use it to do any initialization */
-void B_init()
-{
-  b.id = B;
-  b.pkt_in_transit = NULL;
-  b.state = S_WAITING_DATA_0;
-  b.last_acked = -1;
-  b.timeout = 200;
-  return;
-}
-
-/*****************************************************************
-***************** NETWORK EMULATION CODE STARTS BELOW ***********
-The code below emulates the layer 3 and below network environment:
-  - emulates the tranmission and delivery (possibly with bit-level corruption
-    and packet loss) of packets across the layer 3/4 interface
-  - handles the starting/stopping of a timer, and generates timer
-    interrupts (resulting in calling students timer handler).
-  - generates message to be sent (passed from later 5 to 4)
-
-THERE IS NOT REASON THAT ANY STUDENT SHOULD HAVE TO READ OR UNDERSTAND
-THE CODE BELOW.  YOU SHOLD NOT TOUCH, OR REFERENCE (in your code) ANY
-OF THE DATA STRUCTURES BELOW.  If you're interested in how I designed
-the emulator, you're welcome to look at the code - but again, you should have
-to, and you defeinitely should not have to modify
-******************************************************************/
-
-typedef struct event
-{
-  float evtime;       /* event time */
-  int evtype;         /* event type code */
-  int eventity;       /* entity where event occurs */
-  struct pkt *pktptr; /* ptr to packet (if any) assoc w/ this event */
-  struct event *prev;
-  struct event *next;
-} event_t;
-
-event_t *evlist = NULL; /* the event list */
-
-// Function definition
-void insertevent(event_t *p);
-void generate_next_arrival();
-void init();
-
-/* possible events: */
-#define TIMER_INTERRUPT 0
-#define FROM_LAYER5 1
-#define FROM_LAYER3 2
-
-#define OFF 0
-#define ON 1
-
-int TRACE = 1;   /* for my debugging */
-int nsim = 0;    /* number of messages from 5 to 4 so far */
-int nsimmax = 0; /* number of msgs to generate, then stop */
-float time = 0.000;
-float lossprob;    /* probability that a packet is dropped  */
-float corruptprob; /* probability that one bit is packet is flipped */
-float lambda;      /* arrival rate of messages from layer 5 */
-int ntolayer3;     /* number sent into layer 3 */
-int nlost;         /* number lost in media */
-int ncorrupt;      /* number corrupted by media*/
-
-void main()
-{
-  event_t *eventptr;
-  struct msg msg2give;
-  struct pkt pkt2give;
+  caller_state_t *caller = (caller_state_t *)state;
+  queued_msg_t *queued;
 
-  int i, j;
-  char c;
-
-  init();
-  A_init();
-  B_init();
-
-  while (1)
+  while ((queued = caller->queue_head) != NULL)
   {
-    eventptr = evlist; /* get next event to simulate */
-    if (eventptr == NULL)
-      goto terminate;
-    evlist = evlist->next; /* remove this event from event list */
-    if (evlist != NULL)
-      evlist->prev = NULL;
-    if (TRACE >= 2)
-    {
-      printf("\nEVENT time: %f,", eventptr->evtime);
-      printf("  type: %d", eventptr->evtype);
-      if (eventptr->evtype == 0)
-        printf(", timerinterrupt  ");
-      else if (eventptr->evtype == 1)
-        printf(", fromlayer5 ");
-      else
-        printf(", fromlayer3 ");
-      printf(" entity: %c\n", eventptr->eventity == A ? 'A' : 'B');
-    }
-    time = eventptr->evtime; /* update time to next event time */
-    if (nsim == nsimmax)
-    {
-      break; /* all done with simulation */
-    }
-    if (eventptr->evtype == FROM_LAYER5)
-    {
-      generate_next_arrival(); /* set up future arrival */
-      /* fill in msg to give with string of same letter */
-      j = nsim % 26;
-      for (i = 0; i < 20; i++)
-        msg2give.data[i] = 97 + j;
-      if (TRACE > 2)
-      {
-        printf("          MAINLOOP: data given to student: ");
-        for (i = 0; i < 20; i++)
-          printf("%c", msg2give.data[i]);
-        printf("\n");
-      }
-      nsim++;
-      if (eventptr->eventity == A)
-        A_output(msg2give);
-      else
-        B_output(msg2give);
-    }
-    else if (eventptr->evtype == FROM_LAYER3)
-    {
-      pkt2give.seqnum = eventptr->pktptr->seqnum;
-      pkt2give.acknum = eventptr->pktptr->acknum;
-      pkt2give.checksum = eventptr->pktptr->checksum;
-      for (i = 0; i < 20; i++)
-      {
-        pkt2give.payload[i] = eventptr->pktptr->payload[i];
-      }
-      if (eventptr->eventity == A)
-      {                    /* deliver packet by calling */
-        A_input(pkt2give); /* appropriate entity */
-      }
-      else
-      {
-        B_input(pkt2give);
-      }
-      free(eventptr->pktptr); /* free the memory for packet */
-    }
-    else if (eventptr->evtype == TIMER_INTERRUPT)
-    {
-      if (eventptr->eventity == A)
-        A_timerinterrupt();
-      else
-        B_timerinterrupt();
-    }
-    else
-    {
-      printf("INTERNAL PANIC: unknown event type \n");
-    }
-    free(eventptr);
+    caller->queue_head = queued->next;
+    memory_free(MEMORY_WINDOW, queued, sizeof(queued_msg_t));
   }
-
-terminate:
-  printf(" Simulator terminated at time %f\n after sending %d msgs from layer5\n", time, nsim);
+  memory_free(MEMORY_WINDOW, caller->pkt_in_transit, sizeof(pkt_t));
+  free(caller);
 }
 
-void init() /* initialize the simulator */
+/* called from layer 5, passed the data to be sent to other side */
+static void output(int AorB, int flowid, msg_t message)
 {
-  int i;
-  float sum, avg;
-  float jimsrand();
-
-  printf("-----  Stop and Wait Network Simulator Version 1.1 -------- \n\n");
-  printf("Enter the number of messages to simulate: ");
-  // scanf("%d", &nsimmax);
-  nsimmax = 10;
-  printf("Enter  packet loss probability [enter 0.0 for no loss]:");
-  // scanf("%f", &lossprob);
-  lossprob = 0.1;
-  printf("Enter packet corruption probability [0.0 for no corruption]:");
-  // scanf("%f", &corruptprob);
-  corruptprob = 0.1;
-  printf("Enter average time between messages from sender's layer5 [ > 0.0]:");
-  // scanf("%f", &lambda);
-  lambda = 150;
-  printf("Enter TRACE:");
-  TRACE = 3;
-  // scanf("%d", &TRACE);
-
-  srand(9999); /* init random number generator */
-  sum = 0.0;   /* test random number generator for students */
-  for (i = 0; i < 1000; i++)
-    sum = sum + jimsrand(); /* jimsrand() should be uniform in [0,1] */
-  avg = sum / 1000.0;
-  if (avg < 0.25 || avg > 0.75)
-  {
-    printf("It is likely that random number generation on your machine\n");
-    printf("is different from what this emulator expects.  Please take\n");
-    printf("a look at the routine jimsrand() in the emulator code. Sorry. \n");
-    exit(1);
-  }
-
-  ntolayer3 = 0;
-  nlost = 0;
-  ncorrupt = 0;
-
-  time = 0.0;              /* initialize time to 0.0 */
-  generate_next_arrival(); /* initialize event list */
+  handle_output(get_caller(AorB, flowid), &message);
 }
 
-/****************************************************************************/
-/* jimsrand(): return a float in range [0,1].  The routine below is used to */
-/* isolate all random number generation in one location.  We assume that the*/
-/* system-supplied rand() function return an int in therange [0,mmm]        */
-/****************************************************************************/
-float jimsrand()
+/* called from layer 3, when a packet arrives for layer 4 */
+static void input(int AorB, pkt_t packet)
 {
-  double mmm = 2147483647; /* largest int  - MACHINE DEPENDENT!!!!!!!!   */
-  float x;                 /* individual students may need to change mmm */
-  x = rand() / mmm;        /* x should be uniform in [0,1] */
-  return (x);
+  handle_input(get_caller(AorB, packet.flowid), &packet);
 }
 
-/********************* EVENT HANDLINE ROUTINES *******/
-/*  The next set of routines handle the event list   */
-/*****************************************************/
-
-void printevlist()
+/* called when the timer of one of AorB's flows goes off */
+static void timerinterrupt(int AorB, int flowid)
 {
-  event_t *q;
-  int i;
-  printf("--------------\nEvent List Follows:\n");
-  for (q = evlist; q != NULL; q = q->next)
-  {
-    printf("Event time: %f, type: %d entity: %d\n", q->evtime, q->evtype, q->eventity);
-  }
-  printf("--------------\n");
+  handle_timerinterrupt(get_caller(AorB, flowid));
 }
 
-void generate_next_arrival()
+/* the following routine will be called once (only) before any other */
+/* entity routines are called, it closes flows left from a previous run */
+static void init(int AorB)
 {
-  double x, log(), ceil();
-  event_t *evptr;
-  // char *malloc();
-  float ttime;
-  int tempint;
-
-  if (TRACE > 2)
-    printf("          GENERATE NEXT ARRIVAL: creating new arrival\n");
-
-  x = lambda * jimsrand() * 2; /* x is uniform on [0,2*lambda] */
-                               /* having mean of lambda        */
-  evptr = (event_t *)malloc(sizeof(event_t));
-  evptr->evtime = time + x;
-  evptr->evtype = FROM_LAYER5;
-  if (BIDIRECTIONAL && (jimsrand() > 0.5))
-    evptr->eventity = B;
-  else
-    evptr->eventity = A;
-  insertevent(evptr);
+  conn_table_clear(&connections[AorB], destroy_caller);
+  totals[AorB] = (protocol_sample_t){0};
+  handshake = handshake_mode();
 }
 
-void insertevent(event_t *p)
+static void sample(protocol_sample_t *sample)
 {
-  event_t *q, *qold;
-
-  if (TRACE > 2)
+  for (int i = 0; i < 2; i++)
   {
-    printf("            INSERTEVENT: time is %lf\n", time);
-    printf("            INSERTEVENT: future time will be %lf\n", p->evtime);
+    sample->in_transit += totals[i].in_transit;
+    sample->window += totals[i].window;
+    sample->retransmissions += totals[i].retransmissions;
   }
-  q = evlist; /* q points to header of list in which p struct inserted */
-  if (q == NULL)
-  { /* list is empty */
-    evlist = p;
-    p->next = NULL;
-    p->prev = NULL;
-  }
-  else
-  {
-    for (qold = q; q != NULL && p->evtime > q->evtime; q = q->next)
-      qold = q;
-    if (q == NULL)
-    { /* end of list */
-      qold->next = p;
-      p->prev = qold;
-      p->next = NULL;
-    }
-    else if (q == evlist)
-    { /* front of list */
-      p->next = evlist;
-      p->prev = NULL;
-      p->next->prev = p;
-      evlist = p;
-    }
-    else
-    { /* middle of list */
-      p->next = q;
-      p->prev = q->prev;
-      q->prev->next = p;
-      q->prev = p;
-    }
-  }
-  // printevlist();
-}
-
-/********************** Student-callable ROUTINES ***********************/
-
-/* called by students routine to cancel a previously-started timer */
-void stoptimer(AorB) int AorB; /* A or B is trying to stop timer */
-{
-  event_t *q, *qold;
-
-  if (TRACE > 2)
-    printf("          STOP TIMER: stopping timer at %f\n", time);
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-  for (q = evlist; q != NULL; q = q->next)
-    if ((q->evtype == TIMER_INTERRUPT && q->eventity == AorB))
-    {
-      /* remove this event */
-      if (q->next == NULL && q->prev == NULL)
-        evlist = NULL;          /* remove first and only event on list */
-      else if (q->next == NULL) /* end of list - there is one in front */
-        q->prev->next = NULL;
-      else if (q == evlist)
-      { /* front of list - there must be event after */
-        q->next->prev = NULL;
-        evlist = q->next;
-      }
-      else
-      { /* middle of list */
-        q->next->prev = q->prev;
-        q->prev->next = q->next;
-      }
-      free(q);
-      return;
-    }
-  printf("Warning: unable to cancel your timer. It wasn't running.\n");
 }
 
-void starttimer(AorB, increment) int AorB; /* A or B is trying to stop timer */
-float increment;
+static void report()
 {
+  size_t bytes = 0;
+  int i, j, flows = 0, nqueued, ndropped, max_queue, nrefused = 0;
+  connection_stats_t handshakes = {0};
+  caller_state_t *caller;
 
-  event_t *q;
-  event_t *evptr;
-  // char *malloc();
-
-  if (TRACE > 2)
-    printf("          START TIMER: starting timer at %f\n", time);
-  /* be nice: check to see if timer is already started, if so, then  warn */
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-  for (q = evlist; q != NULL; q = q->next)
-    if ((q->evtype == TIMER_INTERRUPT && q->eventity == AorB))
+  for (i = 0; i < 2; i++)
+  {
+    nqueued = ndropped = max_queue = 0;
+    bytes += conn_table_bytes(&connections[i]);
+    for (j = 0; j < connections[i].capacity; j++)
     {
-      printf("Warning: attempt to start a timer that is already started\n");
-      return;
+      if (connections[i].keys[j] == -1)
+        continue;
+      caller = (caller_state_t *)connections[i].values[j];
+      bytes += sizeof(caller_state_t) + caller->queue_len * sizeof(queued_msg_t);
+      if (caller->pkt_in_transit != NULL)
+        bytes += sizeof(pkt_t);
+      nqueued += caller->nqueued;
+      nrefused += caller->nrefused;
+      connection_add(&handshakes, &caller->connection);
+      ndropped += caller->ndropped;
+      if (caller->max_queue > max_queue)
+        max_queue = caller->max_queue;
     }
-
-  /* create future event for when timer goes off */
-  evptr = (event_t *)malloc(sizeof(event_t));
-  evptr->evtime = time + increment;
-  evptr->evtype = TIMER_INTERRUPT;
-  evptr->eventity = AorB;
-  insertevent(evptr);
-}
-
-/************************** TOLAYER3 ***************/
-void tolayer3(AorB, packet) int AorB; /* A or B is trying to stop timer */
-struct pkt packet;
-{
-  struct pkt *mypktptr;
-  event_t *evptr, *q;
-  // char *malloc();
-  float lastime, x, jimsrand();
-  int i;
-
-  ntolayer3++;
-
-  /* simulate losses: */
-  if (jimsrand() < lossprob)
-  {
-    nlost++;
-    if (TRACE > 0)
-      printf("          TOLAYER3: packet being lost\n");
-    return;
+    if (connections[i].count > flows)
+      flows = connections[i].count;
+    printf("%c send queue: %d queued, %d dropped, %d max (of %d)\n",
+           i == A ? 'A' : 'B', nqueued, ndropped, max_queue, SEND_QUEUE_SIZE);
   }
-
-  /* make a copy of the packet student just gave me since he/she may decide */
-  /* to do something with the packet after we return back to him/her */
-  mypktptr = (struct pkt *)malloc(sizeof(struct pkt));
-  mypktptr->seqnum = packet.seqnum;
-  mypktptr->acknum = packet.acknum;
-  mypktptr->checksum = packet.checksum;
-  for (i = 0; i < 20; i++)
-    mypktptr->payload[i] = packet.payload[i];
-  if (TRACE > 2)
-  {
-    printf("          TOLAYER3: seq: %d, ack %d, check: %d ", mypktptr->seqnum,
-           mypktptr->acknum, mypktptr->checksum);
-    for (i = 0; i < 20; i++)
-      printf("%c", mypktptr->payload[i]);
-    printf("\n");
-  }
-
-  /* create future event for arrival of packet at the other side */
-  evptr = (event_t *)malloc(sizeof(event_t));
-  evptr->evtype = FROM_LAYER3;      /* packet will pop out from layer3 */
-  evptr->eventity = (AorB + 1) % 2; /* event occurs at other entity */
-  evptr->pktptr = mypktptr;         /* save ptr to my copy of packet */
-                                    /* finally, compute the arrival time of packet at the other end.
-                                       medium can not reorder, so make sure packet arrives between 1 and 10
-                                       time units after the latest arrival time of packets
-                                       currently in the medium on their way to the destination */
-  lastime = time;
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next) */
-  for (q = evlist; q != NULL; q = q->next)
-    if ((q->evtype == FROM_LAYER3 && q->eventity == evptr->eventity))
-      lastime = q->evtime;
-  evptr->evtime = lastime + 1 + 9 * jimsrand();
-
-  /* simulate corruption: */
-  if (jimsrand() < corruptprob)
-  {
-    ncorrupt++;
-    if ((x = jimsrand()) < .75)
-      mypktptr->payload[0] = 'Z'; /* corrupt payload */
-    else if (x < .875)
-      mypktptr->seqnum = 999999;
-    else
-      mypktptr->acknum = 999999;
-    if (TRACE > 0)
-      printf("          TOLAYER3: packet being corrupted\n");
-  }
-
-  if (TRACE > 2)
-    printf("          TOLAYER3: scheduling arrival on other side\n");
-  insertevent(evptr);
+  printf("connections: %d at A, %d at B, %zu bytes (%.1f per flow)\n",
+         connections[A].count, connections[B].count, bytes,
+         flows > 0 ? (double)bytes / flows : 0.0);
+  if (nrefused > 0)
+    printf("flow control: %d packets refused by a full receive buffer\n", nrefused);
+  if (handshake != HANDSHAKE_NONE)
+    connection_print(&handshakes);
 }
 
-void tolayer5(AorB, datasent) int AorB;
-char datasent[20];
-{
-  int i;
-  if (TRACE > 2)
-  {
-    printf("          TOLAYER5: data received: ");
-    for (i = 0; i < 20; i++)
-      printf("%c", datasent[i]);
-    printf("\n");
-  }
-}
\ No newline at end of file
+const protocol_t alt_bit_protocol = {"alt-bit", init, output, input, timerinterrupt, report,
+                                       is_corrupted, sample};
@@ -1,51 +1,68 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "connection.h"
+#include "conntable.h"
+#include "emulator.h"
+#include "packet.h"
+#include "protocols.h"
 /* ******************************************************************
- ALTERNATING BIT AND GO-BACK-N NETWORK EMULATOR: VERSION 1.1  J.F.Kurose
-
-   This code should be used for PA2, unidirectional or bidirectional
-   data transfer protocols (from A to B. Bidirectional transfer of data
-   is for extra credit and is not required).  Network properties:
-   - one way network delay averages five time units (longer if there
-     are other messages in the channel for GBN), but can be larger
-   - packets can be corrupted (either the header or the data portion)
-     or lost, according to user-defined probabilities
-   - packets will be delivered in the order in which they were sent
-     (although some can be lost).
+ GO-BACK-N PROTOCOL
+
+   Transport protocol entities A and B, run by the network emulator in
+   emulator.c through goback_n_protocol.  Its variants add congestion
+   control to the fixed window: gbn_loss_protocol opens a congestion
+   window by slow start and additive increase and cuts it on timeouts,
+   and gbn_dctcp_protocol also sends its packets ECN capable and, like
+   DCTCP, cuts the window once per window of data in proportion to the
+   fraction of packets the network marked.  The receivers of every
+   variant echo marks in their ACKs.
+
+   gbn_paced_protocol is gbn_loss_protocol with pacing: rather than
+   sending what the window allows at once, a sender spaces its packets
+   by the round trip time over the window, sped up by PACING_GAIN, so
+   the queues of the medium do not take the bursts.  The emulator gives
+   a flow a single timer, which a paced sender sets to the earlier of
+   its retransmission and pacing deadlines; the emulator counts the
+   pacing ones among the timeouts of the flow.
+
+   Every variant adds forward error correction if fec_group() is k > 0:
+   after the k new packets of each group of sequence numbers it sends
+   their XOR as a parity packet, which is not retransmitted.  The
+   receiver keeps the packets of the group it expects next, so it can
+   rebuild the one it lost from the parity and give it and those after
+   it to layer 5 without waiting for the timeout.  The group should be
+   smaller than the window, or the sender waits for ACKs before it can
+   complete it.
+
+   With a handshake_mode(), a sender opens a connection, see
+   connection.h, when it is given a message with none open, numbering
+   its packets from the ISN + 1, and closes it once the window is
+   empty.  The packets given meanwhile wait for the next one.  The SYN
+   and the FIN are sent again on the retransmission timer, whose
+   timeout doubles on each up to RTO_MAX whatever the variant.
 **********************************************************************/
 
-#define BIDIRECTIONAL 1 /* change to 1 if you're doing extra credit */
-                        /* and write a routine called B_output */
-
-#define A 0
-#define B 1
-
-#define WINDOW_SIZE 5
+#define WINDOW_SIZE 5 /* unless send_window() sets it, or CWND_MAX */
 #define PAYLOAD_SIZE 20
 
-/* a "msg" is the data unit passed from layer 5 (teachers code) to layer  */
-/* 4 (students' code).  It contains the data (characters) to be delivered */
-/* to layer 5 via the students transport level protocol entities.         */
-typedef struct msg
-{
-  char data[20];
-} msg_t;
+/* congestion control, by the variant init() was last called for */
+#define CONTROL_NONE 0  /* the fixed window of WINDOW_SIZE packets */
+#define CONTROL_LOSS 1
+#define CONTROL_DCTCP 2
+
+#define TIMEOUT 20 /* of the fixed window, and the first of congestion control, */
+                   /* unless retransmit_timeout() sets it                      */
+#define CWND_INITIAL 2
+#define CWND_MAX 256
+#define SSTHRESH_INITIAL 64
+#define DCTCP_G (1.0 / 16) /* weight of a window in the marked fraction */
+#define RTO_MIN 5
+#define RTO_MAX 2000
+#define PACING_GAIN_SLOW_START 2.0 /* the window doubles every round trip */
+#define PACING_GAIN 1.25
+#define FEC_PARITY -1 /* acknum of a parity packet, whose seqnum is the first of its group */
 
-/* a packet is the data unit passed from layer 4 (students code) to layer */
-/* 3 (teachers code).  Note the pre-defined packet structure, which all   */
-/* students must follow. */
-typedef struct pkt
-{
-  int seqnum;
-  int acknum;
-  int checksum;
-  char payload[PAYLOAD_SIZE];
-} pkt_t;
-
-void tolayer3(int AorB, pkt_t packet);
-void tolayer5(int AorB, char *data);
-void stoptimer(int);
-void starttimer(int, float);
 /********* STUDENTS WRITE THE NEXT SEVEN ROUTINES *********/
 
 #define NOT_SEND 0
@@ -58,100 +75,78 @@ typedef struct window_packet_s
   int status;
 } window_packet_t;
 
+typedef struct fec_state_s
+{
+  char parity[PAYLOAD_SIZE];   /* of the new packets sent of the group under way */
+  int base;                    /* seqnum of the first packet of the group */
+                               /* being received                          */
+  unsigned int received;       /* bit i set if packet i of it was received */
+  int has_parity;
+  char parity_received[PAYLOAD_SIZE];
+  char payloads[FEC_GROUP_MAX][PAYLOAD_SIZE];
+} fec_state_t;
+
 typedef struct caller_state_s
 {
   int id;
+  int flowid;
 
   int seqnum_base;
   int next_seqnum;
   int last_acked;
-  int timeout;
-  int timer_on;
+  float timeout;
+  int timer_on;        /* the retransmission timer */
+  double rto_deadline; /* when it is on */
+  double pace_deadline; /* of the pacing timer, -1 when it is off */
+  double pace_next;     /* earliest time the next packet may be sent */
+  double timer_deadline; /* of the emulator timer of a paced sender, -1 when off */
 
   window_packet_t *window;
   int in_transit;
-
+  int peer_window; /* free receive buffer the peer advertised, -1 for no limit */
+
+  int nrefused; /* packets refused because the receive buffer was full */
+  int nprobes;  /* zero window probes sent */
+
+  double cwnd;     /* congestion window in packets, unless CONTROL_NONE */
+  double ssthresh;
+  double alpha;    /* estimate of the fraction of packets marked */
+  int sent_end;    /* seqnum after the last new packet sent */
+  int observe_end; /* seqnum whose ACK ends the window being observed */
+  int nobserved;   /* packets ACKed in the window being observed */
+  int nmarked;     /* of them ACKed with the echo of a mark */
+  int nmark_cuts;  /* window cuts on marks */
+  int ntimeout_cuts;
+  double srtt;      /* smoothed round trip time, 0 before the first sample */
+  double rttvar;
+  int rtt_seq;      /* seqnum of the packet being timed, -1 for none */
+  double rtt_start; /* when it was sent */
+
+  fec_state_t *fec; /* if fec_group() > 0 */
+  int nprotected;   /* new packets sent under a parity packet */
+  int nparity;      /* parity packets sent */
+  int nrebuilt;     /* packets rebuilt from a parity packet */
+  int nrecovered;   /* packets the peer ACKed as rebuilt */
+  double saved;     /* time from those ACKs to the timeouts they stopped */
+
+  connection_t connection; /* of the data sent and of the data received */
 } caller_state_t;
 
-caller_state_t a;
-caller_state_t b;
-
-void get_buffer_from_packet(pkt_t *packet, char *buffer)
-{
-  // Loads seqnum to buffer
-  char *tmp_buffer = buffer;
-  *(tmp_buffer + 0) = (packet->seqnum >> 0);
-  *(tmp_buffer + 1) = (packet->seqnum >> 8);
-  *(tmp_buffer + 2) = (packet->seqnum >> 16);
-  *(tmp_buffer + 3) = (packet->seqnum >> 24);
-
-  // Loads acknum to buffer
-  tmp_buffer = buffer + 4;
-  *(tmp_buffer + 0) = (packet->acknum >> 0);
-  *(tmp_buffer + 1) = (packet->acknum >> 8);
-  *(tmp_buffer + 2) = (packet->acknum >> 16);
-  *(tmp_buffer + 3) = (packet->acknum >> 24);
-
-  // Loads payload to buffer
-  tmp_buffer = buffer + 8;
-  for (int i = 0; i < 20; i++)
-  {
-    tmp_buffer[i] = packet->payload[i];
-  }
-}
-
-int get_checksum_from_buffer(char *buffer, size_t size)
-{
-  unsigned int cksum = 0;
-  while (size > 1)
-  {
-    cksum += *((unsigned short *)(buffer + 1));
-    size -= 2;
-    buffer += 2;
-  }
-  if (size)
-    cksum += (unsigned short)(0x00FF & *buffer);
-
-  cksum = (~cksum & 0xffff);
-  return cksum;
-}
-
-int get_checksum(pkt_t *packet)
-{
-  char buffer[sizeof(pkt_t)] = {0x0};
-
-  get_buffer_from_packet(packet, buffer);
-
-  int checksum = get_checksum_from_buffer(buffer, 20);
-
-  return checksum;
-}
-
-int is_corrupted(pkt_t *packet)
-{
-  int checksum = get_checksum(packet);
-  return checksum != packet->checksum;
-}
-
-pkt_t *get_pkt_from_msg(msg_t *msg, int sequence, int acknum)
-{
-  pkt_t *packet = (pkt_t *)malloc(sizeof(pkt_t));
-
-  packet->seqnum = sequence;
-  packet->acknum = acknum;
-
-  for (int i = 0; i < 20; i++)
-  {
-    packet->payload[i] = msg->data[i];
-  }
-
-  packet->checksum = get_checksum(packet);
-
-  return packet;
-}
-
-pkt_t *get_ack_pkt(caller_state_t *caller, pkt_t *packet, pkt_t *received_pkt)
+/* caller_state_t of every flow, by entity.  Per thread, as the parallel */
+/* engine runs the flows of each partition on its own worker.            */
+static __thread conn_table_t connections[2];
+static __thread protocol_sample_t totals[2]; /* of the flows of each entity */
+static __thread int control;                 /* CONTROL_ of the variant run */
+static __thread int pacing;                  /* whether its senders pace */
+static __thread int fec;                     /* fec_group() of the run */
+static __thread int handshake;               /* handshake_mode() of the run */
+static __thread int window_size;             /* WINDOW_SIZE, or send_window() */
+static __thread int cwnd_max;                /* CWND_MAX, or send_window() */
+static __thread float initial_timeout;       /* TIMEOUT, or retransmit_timeout() */
+
+static pkt_t *get_ack_pkt(caller_state_t *caller, pkt_t *packet, pkt_t *received_pkt)
 {
+  packet->flowid = caller->flowid;
   packet->seqnum = caller->seqnum_base;
 
   if (received_pkt == NULL)
@@ -173,34 +168,129 @@ pkt_t *get_ack_pkt(caller_state_t *caller, pkt_t *packet, pkt_t *received_pkt)
     packet->payload[i] = 0;
   }
 
-  packet->checksum = get_checksum(packet);
+  /* advertise the free receive buffer after "ACK\0", if it is bounded */
+  int window = layer5_window(caller->id, caller->flowid);
+  if (window >= 0)
+  {
+    packet->payload[4] = 'W';
+    for (int i = 0; i < 4; i++)
+      packet->payload[5 + i] = window >> (8 * i);
+  }
+  /* echo the congestion experienced mark of the packet ACKed */
+  if (received_pkt != NULL && received_pkt->ecn == ECN_CE)
+    packet->payload[9] = 'E';
+
+  if (handshake != HANDSHAKE_NONE)
+    connection_mark(&caller->connection, packet, 0);
+  else
+    packet->checksum = get_checksum(packet);
+  packet->ecn = ECN_NOT_ECT;
 
   return packet;
 }
 
-int is_ack_packet(pkt_t *packet)
+/* returns the window advertised in ack, or -1 if it has none */
+static int get_advertised_window(pkt_t *ack)
 {
-  return packet->payload[0] == 'A' &&
-         packet->payload[1] == 'C' &&
-         packet->payload[2] == 'K';
+  int window = 0;
+
+  if (ack->payload[4] != 'W')
+    return -1;
+  for (int i = 0; i < 4; i++)
+    window |= (unsigned char)ack->payload[5 + i] << (8 * i);
+  return window;
 }
 
-void send_pkt(caller_state_t *caller, pkt_t *packet)
+/* sets the emulator timer of a paced sender to the earlier of its */
+/* retransmission and pacing deadlines                              */
+static void set_timer(caller_state_t *caller)
+{
+  double deadline = caller->timer_on ? caller->rto_deadline : -1;
+
+  if (caller->pace_deadline >= 0 && (deadline < 0 || caller->pace_deadline < deadline))
+    deadline = caller->pace_deadline;
+  if (deadline == caller->timer_deadline)
+    return;
+  if (caller->timer_deadline >= 0)
+    stoptimer(caller->id, caller->flowid);
+  caller->timer_deadline = deadline;
+  if (deadline >= 0)
+    starttimer(caller->id, caller->flowid, deadline - current_time());
+}
+
+static void start_rto(caller_state_t *caller)
+{
+  caller->timer_on = 1;
+  caller->rto_deadline = current_time() + caller->timeout;
+  if (!pacing)
+  {
+    starttimer(caller->id, caller->flowid, caller->timeout);
+    return;
+  }
+  set_timer(caller);
+}
+
+static void stop_rto(caller_state_t *caller)
 {
-  tolayer3(caller->id, *packet);
   if (!caller->timer_on)
+    return;
+  caller->timer_on = 0;
+  if (!pacing)
   {
-    starttimer(caller->id, caller->timeout);
-    caller->timer_on = 1;
+    stoptimer(caller->id, caller->flowid);
+    return;
   }
+  set_timer(caller);
 }
 
-void add_to_window(caller_state_t *caller, pkt_t *packet)
+static void send_pkt(caller_state_t *caller, pkt_t *packet)
+{
+  tolayer3(caller->id, *packet);
+  if (!caller->timer_on)
+    start_rto(caller);
+}
+
+/* adds a new packet sent to the parity of its group, and sends the */
+/* parity after the last packet of the group                        */
+static void fec_send(caller_state_t *caller, pkt_t *packet)
+{
+  fec_state_t *state = caller->fec;
+  int i, index = packet->seqnum / PAYLOAD_SIZE % fec;
+  pkt_t parity;
+
+  if (index == 0)
+    memset(state->parity, 0, PAYLOAD_SIZE);
+  for (i = 0; i < PAYLOAD_SIZE; i++)
+    state->parity[i] ^= packet->payload[i];
+  caller->nprotected++;
+  if (index < fec - 1)
+    return;
+
+  parity.flowid = caller->flowid;
+  parity.seqnum = packet->seqnum - (fec - 1) * PAYLOAD_SIZE;
+  parity.acknum = FEC_PARITY;
+  memcpy(parity.payload, state->parity, PAYLOAD_SIZE);
+  parity.checksum = get_checksum(&parity);
+  parity.ecn = packet->ecn;
+  tolayer3(caller->id, parity);
+  caller->nparity++;
+}
+
+/* time between the packets of a paced sender, 0 before it has a round */
+/* trip time                                                           */
+static double pacing_interval(caller_state_t *caller)
+{
+  double gain = caller->cwnd < caller->ssthresh ? PACING_GAIN_SLOW_START : PACING_GAIN;
+
+  return caller->srtt / (gain * caller->cwnd);
+}
+
+static void add_to_window(caller_state_t *caller, pkt_t *packet)
 {
   window_packet_t *w_pkt = NULL;
   if (caller->window == NULL)
   {
-    caller->window = (window_packet_t *)malloc(sizeof(window_packet_t));
+    caller->window = (window_packet_t *)memory_alloc(MEMORY_WINDOW, sizeof(window_packet_t));
     w_pkt = caller->window;
   }
   else
@@ -208,98 +298,568 @@ void add_to_window(caller_state_t *caller, pkt_t *packet)
     w_pkt = caller->window;
     while (w_pkt->next != NULL)
       w_pkt = w_pkt->next;
-    w_pkt->next = (window_packet_t *)malloc(sizeof(window_packet_t));
+    w_pkt->next = (window_packet_t *)memory_alloc(MEMORY_WINDOW, sizeof(window_packet_t));
     w_pkt = w_pkt->next;
   }
 
   w_pkt->packet = packet;
   w_pkt->status = NOT_SEND;
   w_pkt->next = NULL;
+  totals[caller->id].window++;
 }
 
-void send_authorized(caller_state_t *caller)
+static void send_authorized(caller_state_t *caller)
 {
   window_packet_t *window = caller->window;
+  int limit = control == CONTROL_NONE ? window_size : (int)caller->cwnd;
+
+  if (caller->connection.state != CONNECTION_ESTABLISHED)
+    return; /* the packets wait for the handshake */
+  if (caller->peer_window >= 0 && caller->peer_window < limit)
+    limit = caller->peer_window;
   while (window != NULL &&
-         caller->in_transit < WINDOW_SIZE)
+         caller->in_transit < limit)
   {
     if (window->status == NOT_SEND)
     {
+      int fresh = window->packet->seqnum >= caller->sent_end;
+
+      if (pacing && caller->pace_next > current_time())
+      {
+        /* the pacing timer sends it */
+        if (caller->pace_deadline < 0)
+        {
+          caller->pace_deadline = caller->pace_next;
+          set_timer(caller);
+        }
+        return;
+      }
+      /* a packet sent before went back to NOT_SEND on a timeout */
+      if (!fresh)
+        totals[caller->id].retransmissions++;
+      else
+      {
+        caller->sent_end = window->packet->seqnum + PAYLOAD_SIZE;
+        if (control != CONTROL_NONE && caller->rtt_seq < 0)
+        {
+          caller->rtt_seq = window->packet->seqnum;
+          caller->rtt_start = current_time();
+        }
+      }
       send_pkt(caller, window->packet);
+      if (fresh && fec > 0)
+        fec_send(caller, window->packet);
       window->status = NOT_ACKED;
       caller->in_transit++;
+      totals[caller->id].in_transit++;
+      if (pacing)
+        caller->pace_next = current_time() + pacing_interval(caller);
     }
     window = window->next;
   }
 }
-void resend_in_transit(caller_state_t *caller)
+/* with a zero window and nothing in transit no ACK will open the window, */
+/* so the timer goes off to probe it                                     */
+static void persist(caller_state_t *caller)
+{
+  window_packet_t *window = caller->window;
+
+  if (caller->peer_window != 0 || caller->in_transit > 0 || caller->timer_on)
+    return;
+  while (window != NULL && window->status != NOT_SEND)
+    window = window->next;
+  if (window == NULL)
+    return;
+  start_rto(caller);
+}
+
+/* sends the next packet beyond the zero window, the ACK it gets back */
+/* advertises the window again                                        */
+static void send_probe(caller_state_t *caller)
+{
+  window_packet_t *window = caller->window;
+  int fresh;
+
+  while (window != NULL && window->status != NOT_SEND)
+    window = window->next;
+  if (window == NULL)
+    return;
+  fresh = window->packet->seqnum >= caller->sent_end;
+  if (fresh)
+    caller->sent_end = window->packet->seqnum + PAYLOAD_SIZE;
+  send_pkt(caller, window->packet);
+  if (fresh && fec > 0)
+    fec_send(caller, window->packet);
+  window->status = NOT_ACKED;
+  caller->in_transit++;
+  totals[caller->id].in_transit++;
+  caller->nprobes++;
+}
+
+/* sets the timeout from a round trip time sample, as RFC 6298 does */
+static void sample_rtt(caller_state_t *caller, double rtt)
+{
+  double deviation;
+
+  if (caller->srtt == 0)
+  {
+    caller->srtt = rtt;
+    caller->rttvar = rtt / 2;
+  }
+  else
+  {
+    deviation = caller->srtt > rtt ? caller->srtt - rtt : rtt - caller->srtt;
+    caller->rttvar = 0.75 * caller->rttvar + 0.25 * deviation;
+    caller->srtt = 0.875 * caller->srtt + 0.125 * rtt;
+  }
+  caller->timeout = caller->srtt + 4 * caller->rttvar;
+  if (caller->timeout < RTO_MIN)
+    caller->timeout = RTO_MIN;
+  if (caller->timeout > RTO_MAX)
+    caller->timeout = RTO_MAX;
+}
+
+/* opens the congestion window for acked packets and, for DCTCP, cuts */
+/* it once per window of data in proportion to the marked fraction    */
+static void congestion_acked(caller_state_t *caller, int acked, int marked, int acknum)
+{
+  if (caller->rtt_seq >= 0 && acknum >= caller->rtt_seq + PAYLOAD_SIZE)
+  {
+    sample_rtt(caller, current_time() - caller->rtt_start);
+    caller->rtt_seq = -1;
+  }
+  if (caller->cwnd < caller->ssthresh)
+    caller->cwnd += acked; /* slow start */
+  else
+    caller->cwnd += (double)acked / caller->cwnd;
+
+  if (control == CONTROL_DCTCP)
+  {
+    caller->nobserved += acked;
+    if (marked)
+      caller->nmarked += acked;
+    if (acknum >= caller->observe_end)
+    {
+      caller->alpha = (1 - DCTCP_G) * caller->alpha +
+                      DCTCP_G * caller->nmarked / caller->nobserved;
+      if (caller->nmarked > 0)
+      {
+        caller->cwnd *= 1 - caller->alpha / 2;
+        caller->ssthresh = caller->cwnd;
+        caller->nmark_cuts++;
+      }
+      caller->nobserved = caller->nmarked = 0;
+      caller->observe_end = caller->sent_end;
+    }
+  }
+  if (caller->cwnd < 1)
+    caller->cwnd = 1;
+  if (caller->cwnd > cwnd_max)
+    caller->cwnd = cwnd_max;
+}
+
+/* a timeout takes every packet in transit for lost: the window starts */
+/* over from one packet and they are sent again as it opens, and the  */
+/* timeout backs off.  A packet sent again gives no round trip time.  */
+static void congestion_timeout(caller_state_t *caller)
+{
+  window_packet_t *window = caller->window;
+
+  caller->ssthresh = caller->cwnd / 2 < 2 ? 2 : caller->cwnd / 2;
+  caller->cwnd = 1;
+  caller->ntimeout_cuts++;
+  caller->rtt_seq = -1;
+  caller->timeout = caller->timeout * 2 > RTO_MAX ? RTO_MAX : caller->timeout * 2;
+  for (; window != NULL && window->status == NOT_ACKED; window = window->next)
+    window->status = NOT_SEND;
+  totals[caller->id].in_transit -= caller->in_transit;
+  caller->in_transit = 0;
+  send_authorized(caller);
+  persist(caller); /* a zero window sent nothing, the timer probes it */
+}
+
+static void resend_in_transit(caller_state_t *caller)
 {
   window_packet_t *window = caller->window;
   while (window != NULL &&
          window->status == NOT_ACKED)
   {
     send_pkt(caller, window->packet);
+    totals[caller->id].retransmissions++;
     window = window->next;
   }
 }
 
-void handle_output(caller_state_t *caller, msg_t *message)
+/* gives layer 5 data received, noting when the connection got its first */
+static void deliver(caller_state_t *caller, char *data)
+{
+  tolayer5(caller->id, caller->flowid, data);
+  connection_delivered(&caller->connection, current_time());
+}
+
+/* seqnum of the first packet of the group of seqnum */
+static int group_base(int seqnum)
+{
+  return seqnum - seqnum / PAYLOAD_SIZE % fec * PAYLOAD_SIZE;
+}
+
+/* keeps a data or parity packet of the group of the next packet expected */
+static void fec_store(caller_state_t *caller, pkt_t *packet)
+{
+  fec_state_t *state = caller->fec;
+  int base = group_base(caller->last_acked), i;
+
+  if (state->base != base)
+  {
+    state->base = base;
+    state->received = 0;
+    state->has_parity = 0;
+  }
+  if (group_base(packet->seqnum) != base)
+    return;
+  if (packet->acknum == FEC_PARITY)
+  {
+    memcpy(state->parity_received, packet->payload, PAYLOAD_SIZE);
+    state->has_parity = 1;
+    return;
+  }
+  i = (packet->seqnum - base) / PAYLOAD_SIZE;
+  memcpy(state->payloads[i], packet->payload, PAYLOAD_SIZE);
+  state->received |= 1u << i;
+}
+
+/* gives layer 5 the packets kept from the next one expected on, first */
+/* rebuilding it if it is the one packet of its group missing.  Returns */
+/* the number given, and whether it rebuilt one in *rebuilt.            */
+static int fec_deliver(caller_state_t *caller, int *rebuilt)
+{
+  fec_state_t *state = caller->fec;
+  unsigned int all = fec == 32 ? ~0u : (1u << fec) - 1;
+  int i, j, k, n = 0;
+
+  *rebuilt = 0;
+  if (state->base != group_base(caller->last_acked))
+    return 0; /* nothing kept of its group yet */
+  i = (caller->last_acked - state->base) / PAYLOAD_SIZE;
+  if (state->has_parity && state->received == (all & ~(1u << i)))
+  {
+    memcpy(state->payloads[i], state->parity_received, PAYLOAD_SIZE);
+    for (j = 0; j < fec; j++)
+      if (j != i)
+        for (k = 0; k < PAYLOAD_SIZE; k++)
+          state->payloads[i][k] ^= state->payloads[j][k];
+    state->received = all;
+    caller->nrebuilt++;
+    *rebuilt = 1;
+  }
+  for (; i < fec && (state->received & (1u << i)) &&
+         layer5_window(caller->id, caller->flowid) != 0;
+       i++, n++)
+  {
+    deliver(caller, state->payloads[i]);
+    caller->last_acked += PAYLOAD_SIZE;
+  }
+  return n;
+}
+
+/* a parity packet, or a data packet from the next one expected on: ACKs */
+/* what it lets layer 5 have, marking the ACK if that took a packet      */
+/* rebuilt.  A parity packet that gives layer 5 nothing is not ACKed.   */
+static void fec_input(caller_state_t *caller, pkt_t *packet)
+{
+  pkt_t ack_pkt;
+  int rebuilt;
+
+  fec_store(caller, packet);
+  if (fec_deliver(caller, &rebuilt) == 0 && packet->acknum == FEC_PARITY)
+    return;
+  get_ack_pkt(caller, &ack_pkt, NULL);
+  if (packet->ecn == ECN_CE)
+    ack_pkt.payload[9] = 'E';
+  if (rebuilt)
+    ack_pkt.payload[10] = 'F';
+  ack_pkt.checksum = get_checksum(&ack_pkt);
+  tolayer3(caller->id, ack_pkt);
+}
+
+/* opens a connection for the packets waiting in the window, numbering */
+/* them from its ISN + 1.  With HANDSHAKE_FASTOPEN the SYN carries the  */
+/* first, which is then in transit.                                     */
+static void open_connection(caller_state_t *caller)
+{
+  connection_t *connection = &caller->connection;
+  window_packet_t *window;
+  int seqnum;
+  pkt_t syn;
+
+  connection_open(connection, caller->id, caller->flowid, current_time());
+  seqnum = connection->isn + 1;
+  for (window = caller->window; window != NULL; window = window->next)
+  {
+    window->packet->seqnum = seqnum;
+    window->packet->checksum = get_checksum(window->packet);
+    seqnum += PAYLOAD_SIZE;
+  }
+  caller->next_seqnum = seqnum;
+  caller->sent_end = caller->observe_end = connection->isn + 1;
+  if (caller->fec != NULL)
+    memset(caller->fec->parity, 0, PAYLOAD_SIZE);
+
+  if (handshake == HANDSHAKE_FASTOPEN)
+  {
+    connection_syn(connection, &syn, caller->flowid, caller->window->packet->payload);
+    caller->window->status = NOT_ACKED;
+    caller->in_transit++;
+    totals[caller->id].in_transit++;
+    caller->sent_end += PAYLOAD_SIZE;
+  }
+  else
+    connection_syn(connection, &syn, caller->flowid, NULL);
+  /* the SYN-ACK gives the first round trip time */
+  caller->rtt_seq = control != CONTROL_NONE ? connection->isn : -1;
+  caller->rtt_start = current_time();
+  send_pkt(caller, &syn);
+}
+
+/* the window is empty: closes the connection with a FIN after it */
+static void close_connection(caller_state_t *caller)
 {
-  pkt_t *packet = get_pkt_from_msg(message, caller->next_seqnum, caller->last_acked);
+  pkt_t fin;
+
+  connection_fin(&caller->connection, &fin, caller->flowid, caller->next_seqnum);
+  send_pkt(caller, &fin);
+}
+
+/* the SYN or the FIN went unanswered: sends it again.  The timer backs */
+/* off whatever the congestion control, so a control packet stuck behind */
+/* a long queue is not sent again on every timeout of a fixed timer.     */
+static void connection_timeout(caller_state_t *caller)
+{
+  connection_t *connection = &caller->connection;
+  pkt_t packet;
+
+  if (connection->state == CONNECTION_SYN_SENT)
+  {
+    connection_syn(connection, &packet, caller->flowid,
+                   handshake == HANDSHAKE_FASTOPEN ? caller->window->packet->payload : NULL);
+    connection->nsyn++;
+  }
+  else
+  {
+    connection_fin(connection, &packet, caller->flowid, connection->fin_seqnum);
+    connection->nfin++;
+  }
+  caller->rtt_seq = -1;
+  caller->timeout = caller->timeout * 2 > RTO_MAX ? RTO_MAX : caller->timeout * 2;
+  send_pkt(caller, &packet);
+}
+
+/* an ACK under a handshake: the SYN-ACK establishes the connection and */
+/* the FIN-ACK closes it, opening the next if packets wait.  Returns     */
+/* whether the ACK goes on to the window, which takes only those of the */
+/* connection established.                                              */
+static int handshake_acked(caller_state_t *caller, pkt_t *packet)
+{
+  connection_t *connection = &caller->connection;
+  pkt_t ack;
+
+  switch (connection->state)
+  {
+  case CONNECTION_SYN_SENT:
+    if (packet->payload[11] != CONNECTION_SYN_ACK || packet->acknum <= connection->isn ||
+        packet->acknum > caller->sent_end)
+      return 0;
+    stop_rto(caller);
+    if (control == CONTROL_NONE)
+      caller->timeout = initial_timeout; /* the data keeps the fixed timer */
+    if (caller->rtt_seq == connection->isn)
+    {
+      sample_rtt(caller, current_time() - caller->rtt_start);
+      caller->rtt_seq = -1;
+    }
+    connection_established(connection, packet, &ack);
+    tolayer3(caller->id, ack);
+    if (caller->in_transit > 0)
+      start_rto(caller); /* for the packet the SYN carried */
+    send_authorized(caller);
+    return 1;
+  case CONNECTION_ESTABLISHED:
+    if (packet->acknum <= connection->isn || packet->acknum > caller->sent_end)
+      return 0; /* of an earlier connection */
+    connection_acked(connection, packet);
+    return 1;
+  case CONNECTION_FIN_SENT:
+    if (connection_fin_acked(connection, packet))
+    {
+      stop_rto(caller);
+      if (control == CONTROL_NONE)
+        caller->timeout = initial_timeout;
+      connection_close(connection, current_time());
+      if (caller->window != NULL)
+        open_connection(caller);
+    }
+    return 0;
+  default:
+    return 0;
+  }
+}
+
+/* a SYN, the ACK of a SYN-ACK or a FIN from the peer */
+static void handshake_input(caller_state_t *caller, pkt_t *packet)
+{
+  connection_t *connection = &caller->connection;
+  pkt_t ack;
+
+  switch (packet->acknum)
+  {
+  case CONNECTION_SYN:
+  case CONNECTION_SYN_DATA:
+    if (connection_accept(connection, caller->id, packet))
+    {
+      caller->last_acked = packet->seqnum + 1;
+      if (caller->fec != NULL)
+        caller->fec->base = -1; /* forgets the groups of the last connection */
+      if (packet->acknum == CONNECTION_SYN_DATA &&
+          layer5_window(caller->id, caller->flowid) != 0)
+      {
+        deliver(caller, packet->payload);
+        caller->last_acked += PAYLOAD_SIZE;
+      }
+    }
+    get_ack_pkt(caller, &ack, NULL);
+    connection_mark(connection, &ack, CONNECTION_SYN_ACK);
+    tolayer3(caller->id, ack);
+    break;
+  case CONNECTION_ACK:
+    connection_confirm(connection, packet);
+    break;
+  case CONNECTION_FIN:
+    if (connection->peer_state != CONNECTION_LISTEN && packet->seqnum != caller->last_acked)
+      break; /* of an earlier connection, or ahead of data lost */
+    connection->peer_state = CONNECTION_LISTEN;
+    get_ack_pkt(caller, &ack, NULL);
+    ack.acknum = packet->seqnum + 1;
+    connection_mark(connection, &ack, CONNECTION_FIN_ACK);
+    tolayer3(caller->id, ack);
+    break;
+  }
+}
+
+static void handle_output(caller_state_t *caller, msg_t *message)
+{
+  pkt_t *packet = get_pkt_from_msg(message, caller->flowid, caller->next_seqnum, caller->last_acked);
+  if (control == CONTROL_DCTCP)
+    packet->ecn = ECN_ECT;
   add_to_window(caller, packet);
   caller->next_seqnum += PAYLOAD_SIZE;
+  if (caller->connection.state == CONNECTION_CLOSED)
+    open_connection(caller);
   send_authorized(caller);
+  persist(caller);
 }
 
-void handle_input(caller_state_t *caller, pkt_t *packet)
+static void handle_input(caller_state_t *caller, pkt_t *packet)
 {
   if (!is_corrupted(packet))
   {
-    if (is_ack_packet(packet))
+    if (CONNECTION_CONTROL(packet->acknum))
+    {
+      if (handshake != HANDSHAKE_NONE)
+        handshake_input(caller, packet);
+    }
+    else if (caller->connection.peer_state == CONNECTION_LISTEN && !is_ack_packet(packet))
     {
-      if (caller->window != NULL &&
-          packet->acknum == (caller->window->packet->seqnum + PAYLOAD_SIZE))
+      /* data or parity of a connection not open */
+    }
+    else if (packet->acknum == FEC_PARITY)
+    {
+      if (fec > 0)
+        fec_input(caller, packet);
+    }
+    else if (is_ack_packet(packet))
+    {
+      if (handshake != HANDSHAKE_NONE && !handshake_acked(caller, packet))
+        return;
+      /* a bit error the checksum missed can ACK packets never sent */
+      if (packet->acknum > caller->sent_end)
+        return;
+
+      /* the peer rebuilt the oldest packet, which the timer would */
+      /* otherwise have sent again                                  */
+      if (packet->payload[10] == 'F' && caller->timer_on)
+      {
+        caller->nrecovered++;
+        if (caller->rto_deadline > current_time())
+          caller->saved += caller->rto_deadline - current_time();
+      }
+
+      /* ACKs are cumulative: release every packet sent they cover, */
+      /* also those a timeout had put back to NOT_SEND               */
+      int acked = 0;
+      while (caller->window != NULL &&
+             packet->acknum >= (caller->window->packet->seqnum + PAYLOAD_SIZE))
       {
         // printf("%c Packet ack:%d acked\n", caller->id == A ? 'A' : 'B', packet->acknum);
 
         window_packet_t *tmp_window = caller->window->next;
-        free(caller->window->packet);
-        free(caller->window);
+        if (caller->window->status == NOT_ACKED)
+        {
+          caller->in_transit--;
+          totals[caller->id].in_transit--;
+        }
+        memory_free(MEMORY_WINDOW, caller->window->packet, sizeof(pkt_t));
+        memory_free(MEMORY_WINDOW, caller->window, sizeof(window_packet_t));
         caller->window = tmp_window;
 
-        caller->in_transit--;
+        totals[caller->id].window--;
+        acked++;
+      }
+      if (acked > 0 && control != CONTROL_NONE)
+        congestion_acked(caller, acked, packet->payload[9] == 'E', packet->acknum);
+
+      int opened = caller->peer_window == 0;
+      caller->peer_window = get_advertised_window(packet);
+      opened = opened && caller->peer_window != 0;
 
-        stoptimer(caller->id);
+      if (acked > 0)
+      {
+        stop_rto(caller);
         if (caller->in_transit > 0)
-        {
-          starttimer(caller->id, caller->timeout);
-        }
-        else
-        {
-          caller->timer_on = 0;
-        }
+          start_rto(caller);
 
         send_authorized(caller);
       }
-      else
+      else if (opened)
       {
-        // if (caller->window != NULL)
-        // printf("ack: %d exp: %d\n", packet->acknum, (caller->window->packet->seqnum + PAYLOAD_SIZE));
-        // printf("%c Ack %d out of order\n", caller->id == A ? 'A' : 'B', packet->acknum);
-        if (caller->timer_on)
-        {
-          stoptimer(caller->id);
-          starttimer(caller->id, caller->timeout);
-        }
-        resend_in_transit(caller);
+        send_authorized(caller);
       }
+      persist(caller);
+      if (handshake != HANDSHAKE_NONE && caller->window == NULL &&
+          caller->connection.state == CONNECTION_ESTABLISHED)
+        close_connection(caller);
+      // a duplicate ACK: the timer recovers the loss. Resending the whole
+      // window on every duplicate makes each of its ACKs trigger another
+      // resend, which floods the channel shared by all flows.
     }
     else
     {
-      if (packet->seqnum == caller->last_acked)
+      connection_confirm(&caller->connection, packet);
+      if (packet->seqnum == caller->last_acked && layer5_window(caller->id, caller->flowid) == 0)
+      {
+        /* no room in the receive buffer: drop it, re-ACK with a zero window */
+        caller->nrefused++;
+        pkt_t ack_pkt;
+        get_ack_pkt(caller, &ack_pkt, NULL);
+        tolayer3(caller->id, ack_pkt);
+      }
+      else if (fec > 0 && packet->seqnum >= caller->last_acked)
+      {
+        fec_input(caller, packet);
+      }
+      else if (packet->seqnum == caller->last_acked)
       {
         if (caller->last_acked < (packet->seqnum + PAYLOAD_SIZE))
-          tolayer5(caller->id, packet->payload);
+          deliver(caller, packet->payload);
         pkt_t ack_pkt;
         get_ack_pkt(caller, &ack_pkt, packet);
         tolayer3(caller->id, ack_pkt);
@@ -312,7 +872,7 @@ void handle_input(caller_state_t *caller, pkt_t *packet)
         // printf("seq: %d exp: %d\n", packet->seqnum, caller->last_acked);
         // printf("%c Packet %d out of order\n", caller->id == A ? 'A' : 'B', packet->seqnum);
         pkt_t ack_pkt;
-        get_ack_pkt(caller, &ack_pkt, packet);
+        get_ack_pkt(caller, &ack_pkt, NULL); /* re-ACK what was received in order */
         // printf("Sending ACK %d\n", ack_pkt.seqnum + PAYLOAD_SIZE);
         tolayer3(caller->id, ack_pkt);
       }
@@ -324,516 +884,231 @@ void handle_input(caller_state_t *caller, pkt_t *packet)
   }
 }
 
-void handle_timerinterrupt(caller_state_t *caller)
+/* the timer of a paced sender went off: returns whether it was the */
+/* retransmission timer, after sending what the pacing timer allows */
+static int paced_timerinterrupt(caller_state_t *caller)
 {
-  caller->timer_on = 0;
-  resend_in_transit(caller);
-}
+  double fired = caller->timer_deadline;
 
-/* called from layer 5, passed the data to be sent to other side */
-void A_output(msg_t message)
-{
-  handle_output(&a, &message);
-  return;
+  caller->timer_deadline = -1;
+  if (caller->pace_deadline >= 0 && caller->pace_deadline <= fired)
+  {
+    caller->pace_deadline = -1;
+    caller->pace_next = 0; /* due, however the timer rounded its deadline */
+    send_authorized(caller);
+  }
+  if (caller->timer_on && caller->rto_deadline <= fired)
+    return 1;
+  set_timer(caller);
+  return 0;
 }
 
-void B_output(msg_t message) /* need be completed only for extra credit */
+static void handle_timerinterrupt(caller_state_t *caller)
 {
-  handle_output(&b, &message);
-  return;
+  if (pacing && !paced_timerinterrupt(caller))
+    return;
+  caller->timer_on = 0;
+  if (caller->connection.state == CONNECTION_SYN_SENT ||
+      caller->connection.state == CONNECTION_FIN_SENT)
+    connection_timeout(caller);
+  else if (caller->in_transit == 0)
+    send_probe(caller);
+  else if (control != CONTROL_NONE)
+    congestion_timeout(caller);
+  else
+    resend_in_transit(caller);
+  if (pacing)
+    set_timer(caller);
 }
 
-/* called from layer 3, when a packet arrives for layer 4 */
-void A_input(pkt_t packet)
+/* returns the state of flowid at entity AorB, opening the flow the */
+/* first time it is seen                                             */
+static caller_state_t *get_caller(int AorB, int flowid)
 {
-  handle_input(&a, &packet);
-  return;
+  caller_state_t *caller = conn_table_get(&connections[AorB], flowid);
+  if (caller != NULL)
+    return caller;
+
+  caller = (caller_state_t *)malloc(sizeof(caller_state_t));
+  caller->id = AorB;
+  caller->flowid = flowid;
+  caller->seqnum_base = 0;
+  caller->next_seqnum = 0;
+  caller->last_acked = 0;
+  caller->timeout = initial_timeout;
+  caller->timer_on = 0;
+  caller->pace_deadline = -1;
+  caller->pace_next = 0;
+  caller->timer_deadline = -1;
+  caller->window = NULL;
+  caller->in_transit = 0;
+  caller->peer_window = -1;
+  caller->nrefused = 0;
+  caller->nprobes = 0;
+  caller->cwnd = CWND_INITIAL;
+  caller->ssthresh = SSTHRESH_INITIAL;
+  caller->alpha = 0;
+  caller->sent_end = 0;
+  caller->observe_end = 0;
+  caller->nobserved = caller->nmarked = 0;
+  caller->nmark_cuts = caller->ntimeout_cuts = 0;
+  caller->srtt = caller->rttvar = 0;
+  caller->rtt_seq = -1;
+  caller->fec = NULL;
+  if (fec > 0)
+    caller->fec = (fec_state_t *)calloc(1, sizeof(fec_state_t));
+  caller->nprotected = caller->nparity = caller->nrebuilt = caller->nrecovered = 0;
+  caller->saved = 0;
+  connection_init(&caller->connection, handshake);
+  conn_table_put(&connections[AorB], flowid, caller);
+  return caller;
 }
 
-/* called when A's timer goes off */
-void A_timerinterrupt()
+static void destroy_caller(void *state)
 {
-  handle_timerinterrupt(&a);
-  return;
-}
-
-/* the following routine will be called once (only) before any other */
-/* entity A routines are called. You can use it to do any initialization */
-void A_init()
-{
-  a.id = A;
-  a.seqnum_base = 0;
-  a.next_seqnum = 0;
-  a.last_acked = 0;
-  a.timeout = 20;
-  a.timer_on = 0;
-  a.window = NULL;
-  a.in_transit = 0;
-
-  return;
-}
-
-/* Note that with simplex transfer from a-to-B, there is no B_output() */
-
-/* called from layer 3, when a packet arrives for layer 4 at B*/
-void B_input(pkt_t packet)
-{
-  handle_input(&b, &packet);
-  return;
-}
-
-/* called when B's timer goes off */
-void B_timerinterrupt()
-{
-  handle_timerinterrupt(&b);
-  return;
-}
-
-/* the following rouytine will be called once (only) before any other */
-/* entity B routines are called. You can use it to do any initialization */
-void B_init()
-{
-  b.id = B;
-  b.seqnum_base = 0;
-  b.next_seqnum = 0;
-  b.last_acked = 0;
-  b.timeout = 20;
-  b.timer_on = 0;
-  b.window = NULL;
-  b.in_transit = 0;
-  return;
-}
-
-/*****************************************************************
-***************** NETWORK EMULATION CODE STARTS BELOW ***********
-The code below emulates the layer 3 and below network environment:
-  - emulates the tranmission and delivery (possibly with bit-level corruption
-    and packet loss) of packets across the layer 3/4 interface
-  - handles the starting/stopping of a timer, and generates timer
-    interrupts (resulting in calling students timer handler).
-  - generates message to be sent (passed from later 5 to 4)
-
-THERE IS NOT REASON THAT ANY STUDENT SHOULD HAVE TO READ OR UNDERSTAND
-THE CODE BELOW.  YOU SHOLD NOT TOUCH, OR REFERENCE (in your code) ANY
-OF THE DATA STRUCTURES BELOW.  If you're interested in how I designed
-the emulator, you're welcome to look at the code - but again, you should have
-to, and you defeinitely should not have to modify
-******************************************************************/
-
-typedef struct event
-{
-  float evtime;       /* event time */
-  int evtype;         /* event type code */
-  int eventity;       /* entity where event occurs */
-  struct pkt *pktptr; /* ptr to packet (if any) assoc w/ this event */
-  struct event *prev;
-  struct event *next;
-} event_t;
-
-event_t *evlist = NULL; /* the event list */
-
-// Function definition
-void insertevent(event_t *p);
-void generate_next_arrival();
-void init();
-
-/* possible events: */
-#define TIMER_INTERRUPT 0
-#define FROM_LAYER5 1
-#define FROM_LAYER3 2
-
-#define OFF 0
-#define ON 1
-
-int TRACE = 1;   /* for my debugging */
-int nsim = 0;    /* number of messages from 5 to 4 so far */
-int nsimmax = 0; /* number of msgs to generate, then stop */
-float time = 0.000;
-float lossprob;    /* probability that a packet is dropped  */
-float corruptprob; /* probability that one bit is packet is flipped */
-float lambda;      /* arrival rate of messages from layer 5 */
-int ntolayer3;     /* number sent into layer 3 */
-int nlost;         /* number lost in media */
-int ncorrupt;      /* number corrupted by media*/
-
-void main()
-{
-  event_t *eventptr;
-  struct msg msg2give;
-  struct pkt pkt2give;
-
-  int i, j;
-  char c;
-
-  init();
-  A_init();
-  B_init();
-
-  while (1)
-  {
-    eventptr = evlist; /* get next event to simulate */
-    if (eventptr == NULL)
-      goto terminate;
-    evlist = evlist->next; /* remove this event from event list */
-    if (evlist != NULL)
-      evlist->prev = NULL;
-    if (TRACE >= 2)
-    {
-      printf("\nEVENT time: %f,", eventptr->evtime);
-      printf("  type: %d", eventptr->evtype);
-      if (eventptr->evtype == 0)
-        printf(", timerinterrupt  ");
-      else if (eventptr->evtype == 1)
-        printf(", fromlayer5 ");
-      else
-        printf(", fromlayer3 ");
-      printf(" entity: %c\n", eventptr->eventity == A ? 'A' : 'B');
-    }
-    time = eventptr->evtime; /* update time to next event time */
-    if (nsim == nsimmax)
-    {
-      break; /* all done with simulation */
-    }
-    if (eventptr->evtype == FROM_LAYER5)
-    {
-      generate_next_arrival(); /* set up future arrival */
-      /* fill in msg to give with string of same letter */
-      j = nsim % 26;
-      for (i = 0; i < 20; i++)
-        msg2give.data[i] = 97 + j;
-      if (TRACE > 2)
-      {
-        printf("          MAINLOOP: data given to student: ");
-        for (i = 0; i < 20; i++)
-          printf("%c", msg2give.data[i]);
-        printf("\n");
-      }
-      nsim++;
-      if (eventptr->eventity == A)
-        A_output(msg2give);
-      else
-        B_output(msg2give);
-    }
-    else if (eventptr->evtype == FROM_LAYER3)
-    {
-      pkt2give.seqnum = eventptr->pktptr->seqnum;
-      pkt2give.acknum = eventptr->pktptr->acknum;
-      pkt2give.checksum = eventptr->pktptr->checksum;
-      for (i = 0; i < 20; i++)
-      {
-        pkt2give.payload[i] = eventptr->pktptr->payload[i];
-      }
-      if (eventptr->eventity == A)
-      {                    /* deliver packet by calling */
-        A_input(pkt2give); /* appropriate entity */
-      }
-      else
-      {
-        B_input(pkt2give);
-      }
-      free(eventptr->pktptr); /* free the memory for packet */
-    }
-    else if (eventptr->evtype == TIMER_INTERRUPT)
-    {
-      if (eventptr->eventity == A)
-        A_timerinterrupt();
-      else
-        B_timerinterrupt();
-    }
-    else
-    {
-      printf("INTERNAL PANIC: unknown event type \n");
-    }
-    free(eventptr);
-  }
+  caller_state_t *caller = (caller_state_t *)state;
+  window_packet_t *window;
 
-terminate:
-  printf(" Simulator terminated at time %f\n after sending %d msgs from layer5\n", time, nsim);
-}
-
-void init() /* initialize the simulator */
-{
-  int i;
-  float sum, avg;
-  float jimsrand();
-
-  printf("-----  Stop and Wait Network Simulator Version 1.1 -------- \n\n");
-  printf("Enter the number of messages to simulate: ");
-  // scanf("%d", &nsimmax);
-  nsimmax = 100;
-  printf("Enter  packet loss probability [enter 0.0 for no loss]:");
-  // scanf("%f", &lossprob);
-  lossprob = 0.2;
-  printf("Enter packet corruption probability [0.0 for no corruption]:");
-  // scanf("%f", &corruptprob);
-  corruptprob = 0.2;
-  printf("Enter average time between messages from sender's layer5 [ > 0.0]:");
-  // scanf("%f", &lambda);
-  lambda = 10;
-  printf("Enter TRACE:");
-  TRACE = 3;
-  // scanf("%d", &TRACE);
-
-  srand(9999); /* init random number generator */
-  sum = 0.0;   /* test random number generator for students */
-  for (i = 0; i < 1000; i++)
-    sum = sum + jimsrand(); /* jimsrand() should be uniform in [0,1] */
-  avg = sum / 1000.0;
-  if (avg < 0.25 || avg > 0.75)
+  while (caller->window != NULL)
   {
-    printf("It is likely that random number generation on your machine\n");
-    printf("is different from what this emulator expects.  Please take\n");
-    printf("a look at the routine jimsrand() in the emulator code. Sorry. \n");
-    exit(1);
+    window = caller->window;
+    caller->window = window->next;
+    memory_free(MEMORY_WINDOW, window->packet, sizeof(pkt_t));
+    memory_free(MEMORY_WINDOW, window, sizeof(window_packet_t));
   }
-
-  ntolayer3 = 0;
-  nlost = 0;
-  ncorrupt = 0;
-
-  time = 0.0;              /* initialize time to 0.0 */
-  generate_next_arrival(); /* initialize event list */
+  free(caller->fec);
+  free(caller);
 }
 
-/****************************************************************************/
-/* jimsrand(): return a float in range [0,1].  The routine below is used to */
-/* isolate all random number generation in one location.  We assume that the*/
-/* system-supplied rand() function return an int in therange [0,mmm]        */
-/****************************************************************************/
-float jimsrand()
+/* called from layer 5, passed the data to be sent to other side */
+static void output(int AorB, int flowid, msg_t message)
 {
-  double mmm = 2147483647; /* largest int  - MACHINE DEPENDENT!!!!!!!!   */
-  float x;                 /* individual students may need to change mmm */
-  x = rand() / mmm;        /* x should be uniform in [0,1] */
-  return (x);
+  handle_output(get_caller(AorB, flowid), &message);
 }
 
-/********************* EVENT HANDLINE ROUTINES *******/
-/*  The next set of routines handle the event list   */
-/*****************************************************/
-
-void printevlist()
+/* called from layer 3, when a packet arrives for layer 4 */
+static void input(int AorB, pkt_t packet)
 {
-  event_t *q;
-  int i;
-  printf("--------------\nEvent List Follows:\n");
-  for (q = evlist; q != NULL; q = q->next)
-  {
-    printf("Event time: %f, type: %d entity: %d\n", q->evtime, q->evtype, q->eventity);
-  }
-  printf("--------------\n");
+  handle_input(get_caller(AorB, packet.flowid), &packet);
 }
 
-void generate_next_arrival()
+/* called when the timer of one of AorB's flows goes off */
+static void timerinterrupt(int AorB, int flowid)
 {
-  double x, log(), ceil();
-  event_t *evptr;
-  // char *malloc();
-  float ttime;
-  int tempint;
-
-  if (TRACE > 2)
-    printf("          GENERATE NEXT ARRIVAL: creating new arrival\n");
-
-  x = lambda * jimsrand() * 2; /* x is uniform on [0,2*lambda] */
-                               /* having mean of lambda        */
-  evptr = (event_t *)malloc(sizeof(event_t));
-  evptr->evtime = time + x;
-  evptr->evtype = FROM_LAYER5;
-  if (BIDIRECTIONAL && (jimsrand() > 0.5))
-    evptr->eventity = B;
-  else
-    evptr->eventity = A;
-  insertevent(evptr);
+  handle_timerinterrupt(get_caller(AorB, flowid));
 }
 
-void insertevent(event_t *p)
+/* the following routine will be called once (only) before any other */
+/* entity routines are called, it closes flows left from a previous run */
+static void init(int AorB)
 {
-  event_t *q, *qold;
-
-  if (TRACE > 2)
-  {
-    printf("            INSERTEVENT: time is %lf\n", time);
-    printf("            INSERTEVENT: future time will be %lf\n", p->evtime);
-  }
-  q = evlist; /* q points to header of list in which p struct inserted */
-  if (q == NULL)
-  { /* list is empty */
-    evlist = p;
-    p->next = NULL;
-    p->prev = NULL;
-  }
-  else
-  {
-    for (qold = q; q != NULL && p->evtime > q->evtime; q = q->next)
-      qold = q;
-    if (q == NULL)
-    { /* end of list */
-      qold->next = p;
-      p->prev = qold;
-      p->next = NULL;
-    }
-    else if (q == evlist)
-    { /* front of list */
-      p->next = evlist;
-      p->prev = NULL;
-      p->next->prev = p;
-      evlist = p;
-    }
-    else
-    { /* middle of list */
-      p->next = q;
-      p->prev = q->prev;
-      q->prev->next = p;
-      q->prev = p;
-    }
-  }
-  // printevlist();
+  conn_table_clear(&connections[AorB], destroy_caller);
+  totals[AorB] = (protocol_sample_t){0};
+  control = CONTROL_NONE;
+  pacing = 0;
+  fec = fec_group();
+  handshake = handshake_mode();
+  window_size = send_window() > 0 ? send_window() : WINDOW_SIZE;
+  cwnd_max = send_window() > 0 ? send_window() : CWND_MAX;
+  initial_timeout = retransmit_timeout() > 0 ? retransmit_timeout() : TIMEOUT;
 }
 
-/********************** Student-callable ROUTINES ***********************/
-
-/* called by students routine to cancel a previously-started timer */
-void stoptimer(AorB) int AorB; /* A or B is trying to stop timer */
+static void init_loss(int AorB)
 {
-  event_t *q, *qold;
-
-  if (TRACE > 2)
-    printf("          STOP TIMER: stopping timer at %f\n", time);
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-  for (q = evlist; q != NULL; q = q->next)
-    if ((q->evtype == TIMER_INTERRUPT && q->eventity == AorB))
-    {
-      /* remove this event */
-      if (q->next == NULL && q->prev == NULL)
-        evlist = NULL;          /* remove first and only event on list */
-      else if (q->next == NULL) /* end of list - there is one in front */
-        q->prev->next = NULL;
-      else if (q == evlist)
-      { /* front of list - there must be event after */
-        q->next->prev = NULL;
-        evlist = q->next;
-      }
-      else
-      { /* middle of list */
-        q->next->prev = q->prev;
-        q->prev->next = q->next;
-      }
-      free(q);
-      return;
-    }
-  printf("Warning: unable to cancel your timer. It wasn't running.\n");
+  init(AorB);
+  control = CONTROL_LOSS;
 }
 
-void starttimer(AorB, increment) int AorB; /* A or B is trying to stop timer */
-float increment;
+static void init_dctcp(int AorB)
 {
-
-  event_t *q;
-  event_t *evptr;
-  // char *malloc();
-
-  if (TRACE > 2)
-    printf("          START TIMER: starting timer at %f\n", time);
-  /* be nice: check to see if timer is already started, if so, then  warn */
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-  for (q = evlist; q != NULL; q = q->next)
-    if ((q->evtype == TIMER_INTERRUPT && q->eventity == AorB))
-    {
-      printf("Warning: attempt to start a timer that is already started\n");
-      return;
-    }
-
-  /* create future event for when timer goes off */
-  evptr = (event_t *)malloc(sizeof(event_t));
-  evptr->evtime = time + increment;
-  evptr->evtype = TIMER_INTERRUPT;
-  evptr->eventity = AorB;
-  insertevent(evptr);
+  init(AorB);
+  control = CONTROL_DCTCP;
 }
 
-/************************** TOLAYER3 ***************/
-void tolayer3(AorB, packet) int AorB; /* A or B is trying to stop timer */
-struct pkt packet;
+static void init_paced(int AorB)
 {
-  struct pkt *mypktptr;
-  event_t *evptr, *q;
-  // char *malloc();
-  float lastime, x, jimsrand();
-  int i;
-
-  ntolayer3++;
+  init(AorB);
+  control = CONTROL_LOSS;
+  pacing = 1;
+}
 
-  /* simulate losses: */
-  if (jimsrand() < lossprob)
+static void sample(protocol_sample_t *sample)
+{
+  for (int i = 0; i < 2; i++)
   {
-    nlost++;
-    if (TRACE > 0)
-      printf("          TOLAYER3: packet being lost\n");
-    return;
+    sample->in_transit += totals[i].in_transit;
+    sample->window += totals[i].window;
+    sample->retransmissions += totals[i].retransmissions;
   }
+}
 
-  /* make a copy of the packet student just gave me since he/she may decide */
-  /* to do something with the packet after we return back to him/her */
-  mypktptr = (struct pkt *)malloc(sizeof(struct pkt));
-  mypktptr->seqnum = packet.seqnum;
-  mypktptr->acknum = packet.acknum;
-  mypktptr->checksum = packet.checksum;
-  for (i = 0; i < 20; i++)
-    mypktptr->payload[i] = packet.payload[i];
-  if (TRACE > 2)
-  {
-    printf("          TOLAYER3: seq: %d, ack %d, check: %d ", mypktptr->seqnum,
-           mypktptr->acknum, mypktptr->checksum);
-    for (i = 0; i < 20; i++)
-      printf("%c", mypktptr->payload[i]);
-    printf("\n");
-  }
+static void report()
+{
+  size_t bytes = 0;
+  int i, j, flows = 0, nrefused = 0, nprobes = 0, senders = 0;
+  int nmark_cuts = 0, ntimeout_cuts = 0, nparity = 0, nrebuilt = 0, nrecovered = 0;
+  long nprotected = 0;
+  double cwnd = 0, alpha = 0, saved = 0;
+  connection_stats_t handshakes = {0};
+  caller_state_t *caller;
+  window_packet_t *window;
 
-  /* create future event for arrival of packet at the other side */
-  evptr = (event_t *)malloc(sizeof(event_t));
-  evptr->evtype = FROM_LAYER3;      /* packet will pop out from layer3 */
-  evptr->eventity = (AorB + 1) % 2; /* event occurs at other entity */
-  evptr->pktptr = mypktptr;         /* save ptr to my copy of packet */
-                                    /* finally, compute the arrival time of packet at the other end.
-                                       medium can not reorder, so make sure packet arrives between 1 and 10
-                                       time units after the latest arrival time of packets
-                                       currently in the medium on their way to the destination */
-  lastime = time;
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next) */
-  for (q = evlist; q != NULL; q = q->next)
-    if ((q->evtype == FROM_LAYER3 && q->eventity == evptr->eventity))
-      lastime = q->evtime;
-  evptr->evtime = lastime + 1 + 9 * jimsrand();
-
-  /* simulate corruption: */
-  if (jimsrand() < corruptprob)
+  for (i = 0; i < 2; i++)
   {
-    ncorrupt++;
-    if ((x = jimsrand()) < .75)
-      mypktptr->payload[0] = 'Z'; /* corrupt payload */
-    else if (x < .875)
-      mypktptr->seqnum = 999999;
-    else
-      mypktptr->acknum = 999999;
-    if (TRACE > 0)
-      printf("          TOLAYER3: packet being corrupted\n");
+    bytes += conn_table_bytes(&connections[i]);
+    for (j = 0; j < connections[i].capacity; j++)
+    {
+      if (connections[i].keys[j] == -1)
+        continue;
+      caller = (caller_state_t *)connections[i].values[j];
+      bytes += sizeof(caller_state_t) + (caller->fec != NULL ? sizeof(fec_state_t) : 0);
+      nrefused += caller->nrefused;
+      nprotected += caller->nprotected;
+      nparity += caller->nparity;
+      nrebuilt += caller->nrebuilt;
+      nrecovered += caller->nrecovered;
+      saved += caller->saved;
+      nprobes += caller->nprobes;
+      connection_add(&handshakes, &caller->connection);
+      if (caller->sent_end > 0)
+      {
+        senders++;
+        cwnd += caller->cwnd;
+        alpha += caller->alpha;
+        nmark_cuts += caller->nmark_cuts;
+        ntimeout_cuts += caller->ntimeout_cuts;
+      }
+      for (window = caller->window; window != NULL; window = window->next)
+        bytes += sizeof(window_packet_t) + sizeof(pkt_t);
+    }
+    if (connections[i].count > flows)
+      flows = connections[i].count;
   }
-
-  if (TRACE > 2)
-    printf("          TOLAYER3: scheduling arrival on other side\n");
-  insertevent(evptr);
+  printf("connections: %d at A, %d at B, %zu bytes (%.1f per flow)\n",
+         connections[A].count, connections[B].count, bytes,
+         flows > 0 ? (double)bytes / flows : 0.0);
+  if (nrefused > 0 || nprobes > 0)
+    printf("flow control: %d packets refused by a full receive buffer, %d zero window probes\n",
+           nrefused, nprobes);
+  if (control != CONTROL_NONE && senders > 0)
+    printf("congestion control: %d window cuts on ECN marks, %d on timeouts; %.1f packets "
+           "window and %.3f marked fraction on average at the end\n",
+           nmark_cuts, ntimeout_cuts, cwnd / senders, alpha / senders);
+  if (fec > 0)
+    printf("forward error correction: groups of %d, %d parity packets (%.1f%% overhead), "
+           "%d packets rebuilt; %d ACKed as rebuilt stopped a running timeout %.2f early "
+           "on average\n",
+           fec, nparity, nprotected > 0 ? 100.0 * nparity / nprotected : 0.0, nrebuilt, nrecovered,
+           nrecovered > 0 ? saved / nrecovered : 0.0);
+  if (handshake != HANDSHAKE_NONE)
+    connection_print(&handshakes);
 }
 
-void tolayer5(AorB, datasent) int AorB;
-char datasent[20];
-{
-  int i;
-  if (TRACE > 2)
-  {
-    printf("          TOLAYER5: data received: ");
-    for (i = 0; i < 20; i++)
-      printf("%c", datasent[i]);
-    printf("\n");
-  }
-}
\ No newline at end of file
+const protocol_t goback_n_protocol = {"gbn", init, output, input, timerinterrupt, report,
+                                        is_corrupted, sample};
+const protocol_t gbn_loss_protocol = {"gbn-loss", init_loss, output, input, timerinterrupt,
+                                      report, is_corrupted, sample};
+const protocol_t gbn_dctcp_protocol = {"gbn-dctcp", init_dctcp, output, input, timerinterrupt,
+                                       report, is_corrupted, sample};
+const protocol_t gbn_paced_protocol = {"gbn-paced", init_paced, output, input, timerinterrupt,
+                                       report, is_corrupted, sample};
@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "backend.h"
+#include "topology.h"
+
+#define LINE_SIZE 512
+
+/* returns the node named name, added as a router if it is new, or -1 */
+static int find_node(topology_t *topology, const char *name)
+{
+  int i;
+
+  for (i = 0; i < topology->nnodes; i++)
+    if (strcmp(topology->names[i], name) == 0)
+      return i;
+  if (i == TOPOLOGY_NODES || strlen(name) >= TOPOLOGY_NAME_SIZE)
+    return -1;
+  strcpy(topology->names[i], name);
+  topology->nnodes++;
+  return i;
+}
+
+/* returns the link from node from to node to, or -1 */
+static int find_link(const topology_t *topology, int from, int to)
+{
+  for (int i = 0; i < topology->nlinks; i++)
+    if (topology->links[i].from == from && topology->links[i].to == to)
+      return i;
+  return -1;
+}
+
+/* applies key=value to params and *jitter, returns 0 or -1 */
+static int link_option(const char *option, emulator_params_t *params, float *jitter)
+{
+  const char *value = strchr(option, '=');
+  size_t n;
+
+  if (value == NULL)
+    return -1;
+  n = value++ - option;
+  if (n == 9 && strncmp(option, "bandwidth", n) == 0)
+    return (params->bandwidth = atof(value)) >= 0 ? 0 : -1;
+  if (n == 5 && strncmp(option, "delay", n) == 0)
+    return (params->propdelay = atof(value)) >= 0 ? 0 : -1;
+  if (n == 6 && strncmp(option, "jitter", n) == 0)
+    return (*jitter = atof(value)) >= 0 ? 0 : -1;
+  if (n == 5 && strncmp(option, "queue", n) == 0)
+    return (params->queue_limit = atoi(value)) >= 0 ? 0 : -1;
+  if (n == 3 && strncmp(option, "ecn", n) == 0)
+    return (params->ecn_threshold = atoi(value)) >= 0 ? 0 : -1;
+  if (n == 6 && strncmp(option, "policy", n) == 0)
+  {
+    if (strcmp(value, "droptail") == 0)
+      params->queue_policy = QUEUE_DROPTAIL;
+    else if (strcmp(value, "red") == 0)
+      params->queue_policy = QUEUE_RED;
+    else
+      return -1;
+    return 0;
+  }
+  if (n == 4 && strncmp(option, "loss", n) == 0)
+  {
+    params->loss_model = LOSS_BERNOULLI;
+    params->lossprob = atof(value);
+    return params->lossprob >= 0 && params->lossprob <= 1 ? 0 : -1;
+  }
+  if (n == 7 && strncmp(option, "gilbert", n) == 0)
+  {
+    params->loss_model = LOSS_GILBERT;
+    if (sscanf(value, "%f,%f,%f,%f", &params->ge_p, &params->ge_r, &params->ge_loss_good,
+               &params->ge_loss_bad) != 4)
+      return -1;
+    return params->ge_p >= 0 && params->ge_p <= 1 && params->ge_r >= 0 && params->ge_r <= 1 &&
+                   params->ge_loss_good >= 0 && params->ge_loss_good <= 1 &&
+                   params->ge_loss_bad >= 0 && params->ge_loss_bad <= 1
+               ? 0
+               : -1;
+  }
+  if (n == 5 && strncmp(option, "trace", n) == 0)
+  {
+    if (params->loss_model == LOSS_TRACE)
+      free((void *)params->loss_trace);
+    params->loss_model = LOSS_TRACE;
+    params->loss_trace = strdup(value);
+    return 0;
+  }
+  if (n == 7 && strncmp(option, "corrupt", n) == 0)
+    return (params->corruptprob = atof(value)) >= 0 && params->corruptprob <= 1 ? 0 : -1;
+  return -1;
+}
+
+/* parses the link statement in the words after "link", returns 0 or -1 */
+static int add_link(topology_t *topology, const emulator_params_t *run, char *words,
+                    char **error)
+{
+  topology_link_t config = {0};
+  char *save, *word;
+  int from, to;
+
+  if ((word = strtok_r(words, " \t\r\n", &save)) == NULL ||
+      (from = find_node(topology, word)) < 0 ||
+      (word = strtok_r(NULL, " \t\r\n", &save)) == NULL ||
+      (to = find_node(topology, word)) < 0)
+  {
+    *error = "a link joins two nodes, of up to 15 characters, 64 at most";
+    return -1;
+  }
+  if (from == to || find_link(topology, from, to) >= 0)
+  {
+    *error = "a link joins two different nodes, once";
+    return -1;
+  }
+
+  config.params = *run;
+  config.params.lossprob = 0;
+  config.params.corruptprob = 0;
+  config.params.ber = 0;
+  config.params.loss_model = LOSS_BERNOULLI;
+  config.params.loss_trace = NULL;
+  while ((word = strtok_r(NULL, " \t\r\n", &save)) != NULL)
+    if (link_option(word, &config.params, &config.jitter) < 0)
+    {
+      if (config.params.loss_model == LOSS_TRACE)
+        free((void *)config.params.loss_trace);
+      *error = "unknown or invalid link key";
+      return -1;
+    }
+
+  topology->links = (topology_link_t *)realloc(topology->links, (topology->nlinks + 2) *
+                                                                    sizeof(topology_link_t));
+  config.from = from;
+  config.to = to;
+  topology->links[topology->nlinks++] = config;
+  config.from = to;
+  config.to = from;
+  if (config.params.loss_model == LOSS_TRACE) /* each direction reads the trace */
+    config.params.loss_trace = strdup(config.params.loss_trace);
+  topology->links[topology->nlinks++] = config;
+  return 0;
+}
+
+/* parses the route statement in the words after "route", returns 0 or -1 */
+static int add_route(topology_t *topology, char *words, char **error)
+{
+  char *save, *node, *host, *next;
+  int from, dest, to, i;
+
+  node = strtok_r(words, " \t\r\n", &save);
+  host = strtok_r(NULL, " \t\r\n", &save);
+  next = strtok_r(NULL, " \t\r\n", &save);
+  if (node == NULL || host == NULL || next == NULL || strtok_r(NULL, " \t\r\n", &save) != NULL)
+  {
+    *error = "a route is a router, a host and a neighbour of the router";
+    return -1;
+  }
+  from = find_node(topology, node);
+  dest = find_node(topology, host);
+  to = find_node(topology, next);
+  if (from < 2 || (dest != A && dest != B) || (i = find_link(topology, from, to)) < 0 ||
+      to == !dest)
+  {
+    *error = "a route is a router, a host and a neighbour of the router";
+    return -1;
+  }
+  topology->route[from][dest] = i;
+  return 0;
+}
+
+/* fills the routes not given with those of the fewest hops to each host */
+static void shortest_routes(topology_t *topology)
+{
+  int seen[TOPOLOGY_NODES], queue[TOPOLOGY_NODES];
+  int dest, head, tail, node, i;
+
+  for (dest = A; dest <= B; dest++)
+  {
+    memset(seen, 0, sizeof(seen));
+    seen[dest] = 1;
+    queue[0] = dest;
+    /* breadth first from the host, back along the links */
+    for (head = 0, tail = 1; head < tail; head++)
+    {
+      node = queue[head];
+      if (node == !dest)
+        continue; /* the other host does not forward */
+      for (i = 0; i < topology->nlinks; i++)
+      {
+        topology_link_t *link = &topology->links[i];
+
+        if (link->to != node || seen[link->from])
+          continue;
+        seen[link->from] = 1;
+        queue[tail++] = link->from;
+        if (topology->route[link->from][dest] < 0)
+          topology->route[link->from][dest] = i;
+      }
+    }
+  }
+}
+
+/* returns 0 if the routes from each host get to the other, or -1 */
+static int check_routes(const topology_t *topology, char **error)
+{
+  int dest, node, hops;
+
+  for (dest = A; dest <= B; dest++)
+  {
+    for (node = !dest, hops = 0; node != dest; hops++)
+    {
+      if (topology->route[node][dest] < 0)
+      {
+        *error = dest == B ? "no route from A to B" : "no route from B to A";
+        return -1;
+      }
+      if (hops == topology->nnodes)
+      {
+        *error = dest == B ? "the routes from A to B loop" : "the routes from B to A loop";
+        return -1;
+      }
+      node = topology->links[topology->route[node][dest]].to;
+    }
+  }
+  return 0;
+}
+
+int topology_open(topology_t *topology, const emulator_params_t *params)
+{
+  char line[LINE_SIZE], *error = NULL, *save, *word;
+  FILE *file;
+  int i, n = 0;
+
+  memset(topology, 0, sizeof(*topology));
+  if ((file = fopen(params->topology, "r")) == NULL)
+  {
+    perror(params->topology);
+    return -1;
+  }
+  strcpy(topology->names[A], "A");
+  strcpy(topology->names[B], "B");
+  topology->nnodes = 2;
+  for (i = 0; i < TOPOLOGY_NODES; i++)
+    topology->route[i][A] = topology->route[i][B] = -1;
+
+  while (error == NULL && fgets(line, sizeof(line), file) != NULL)
+  {
+    n++;
+    if ((word = strchr(line, '#')) != NULL)
+      *word = '\0';
+    if ((word = strtok_r(line, " \t\r\n", &save)) == NULL)
+      continue;
+    if (strcmp(word, "link") == 0)
+      add_link(topology, params, save, &error);
+    else if (strcmp(word, "route") == 0)
+      add_route(topology, save, &error);
+    else
+      error = "a statement is link or route";
+  }
+  fclose(file);
+  if (error == NULL)
+  {
+    shortest_routes(topology);
+    if (check_routes(topology, &error) < 0)
+      n = 0;
+  }
+  if (error != NULL)
+  {
+    if (n > 0)
+      fprintf(stderr, "%s:%d: %s\n", params->topology, n, error);
+    else
+      fprintf(stderr, "%s: %s\n", params->topology, error);
+    topology_close(topology);
+    return -1;
+  }
+
+  /* the links point to their params, which stay put from here on */
+  for (i = 0; i < topology->nlinks; i++)
+  {
+    topology_link_t *link = &topology->links[i];
+
+    link_init(&link->link, &link->params, &link->stats);
+    if (loss_open(&link->loss, &link->params) < 0)
+    {
+      topology_close(topology); /* the loss models not opened are zeroed */
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int topology_send(topology_t *topology, int node, int dest, double now, pkt_t *packet,
+                  int *next, double *arrival, emulator_stats_t *stats)
+{
+  topology_link_t *link = &topology->links[topology->route[node][dest]];
+  double delay;
+
+  if (link->params.bandwidth > 0 && !link_admit(&link->link, now, jimsrand(), &packet->ecn))
+    return TOPOLOGY_DROPPED;
+  if (loss_draw(&link->loss, A, &delay, stats))
+  {
+    link->nlost++;
+    if (link->params.bandwidth > 0)
+      link_transmit(&link->link, now); /* lost on the wire */
+    return TOPOLOGY_LOST;
+  }
+
+  if (link->params.bandwidth > 0)
+    *arrival = link_transmit(&link->link, now);
+  else
+  {
+    *arrival = now + link->params.propdelay;
+    link->stats.npackets++;
+  }
+  if (delay >= 0) /* the trace delay replaces the propagation delay */
+    *arrival += delay - link->params.propdelay;
+  if (link->jitter > 0)
+    *arrival += link->jitter * jimsrand();
+  if (*arrival < link->last_arrival) /* the link does not reorder */
+    *arrival = link->last_arrival;
+  link->last_arrival = *arrival;
+  *next = link->to;
+
+  if (link->params.corruptprob > 0 && jimsrand() < link->params.corruptprob)
+  {
+    corrupt_packet(packet, jimsrand());
+    link->ncorrupt++;
+    return TOPOLOGY_CORRUPTED;
+  }
+  return TOPOLOGY_SENT;
+}
+
+void topology_finish(topology_t *topology, double now)
+{
+  for (int i = 0; i < topology->nlinks; i++)
+    if (topology->links[i].params.bandwidth > 0)
+      link_close(&topology->links[i].link, now);
+}
+
+void topology_close(topology_t *topology)
+{
+  for (int i = 0; i < topology->nlinks; i++)
+  {
+    loss_close(&topology->links[i].loss);
+    free(topology->links[i].link.departures); /* if the run did not finish */
+    if (topology->links[i].params.loss_model == LOSS_TRACE)
+      free((void *)topology->links[i].params.loss_trace);
+  }
+  free(topology->links);
+  topology->links = NULL;
+  topology->nlinks = 0;
+  topology->nnodes = 0;
+}
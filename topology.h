@@ -0,0 +1,88 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+#include "emulator.h"
+#include "link.h"
+#include "loss.h"
+
+/* ******************************************************************
+ MULTI-HOP TOPOLOGIES
+
+   Replaces the single medium between A and B with hosts and
+   store-and-forward routers joined by links, read from
+   emulator_params_t.topology, a text file with one statement per
+   line ('#' starts a comment):
+
+     link NODE NODE [key=value ...]
+     route NODE HOST NODE
+
+   A and B are the hosts, every other name a router.  A link joins two
+   nodes in both directions, each direction with its own buffer, loss
+   model and statistics, set by the keys:
+     bandwidth=bytes   per time unit, 0 for no serialization
+     delay=time        propagation delay
+     jitter=time       extra delay, uniform on [0, jitter]
+     queue=packets     buffer size, 0 for no limit
+     policy=droptail|red
+     ecn=packets       queue from which packets are marked, see link.h
+     loss=prob         Bernoulli loss probability
+     gilbert=p,r,good,bad  Gilbert-Elliott loss instead
+     trace=file        loss/delay trace instead, see loss.h
+     corrupt=prob      probability that a packet is corrupted
+   Bandwidth, delay, queue, policy and ecn default to the -b, -d, -q,
+   -Q and -E options of the run, the others to none; the loss, corruption and
+   bit error settings of the run itself are not applied.
+
+   Routing is static: route makes a router send the packets for a host
+   to a neighbour.  The routes not given follow a path with the fewest
+   hops, ties going to the link named first, and do not pass through
+   the other host.  A router forwards a packet once it has received
+   all of it.  Packets keep their order on a link, but may overtake
+   each other on different paths.
+**********************************************************************/
+
+#define TOPOLOGY_NODES 64
+#define TOPOLOGY_NAME_SIZE 16
+
+/* what topology_send() did with a packet */
+#define TOPOLOGY_SENT 0
+#define TOPOLOGY_CORRUPTED 1 /* sent, but corrupted on the way */
+#define TOPOLOGY_DROPPED 2   /* by the buffer of the link */
+#define TOPOLOGY_LOST 3
+
+typedef struct topology_link_s
+{
+  int from, to;              /* nodes */
+  emulator_params_t params;  /* bandwidth, delay, buffer and loss model */
+  float jitter;
+  link_t link;               /* if params.bandwidth > 0 */
+  loss_model_t loss;
+  double last_arrival;       /* of the packets sent so far */
+  link_stats_t stats;
+  long nlost;
+  long ncorrupt;
+} topology_link_t;
+
+typedef struct topology_s
+{
+  int nnodes;                /* 0 for none, A and B are nodes A and B */
+  char names[TOPOLOGY_NODES][TOPOLOGY_NAME_SIZE];
+  int nlinks;
+  topology_link_t *links;    /* link i goes from the first node named */
+                             /* to the second if i is even            */
+  int route[TOPOLOGY_NODES][2]; /* link from each node to each host */
+} topology_t;
+
+/* reads params->topology, returns 0, or -1 after printing why it can */
+/* not be used                                                         */
+int topology_open(topology_t *topology, const emulator_params_t *params);
+/* sends packet, at node at time now, over the next link to host dest.  */
+/* Returns a TOPOLOGY_ outcome, and for a packet sent, the node and the */
+/* time it arrives at.  A corrupted packet is changed in place.  Loss   */
+/* bursts are accounted in stats.                                       */
+int topology_send(topology_t *topology, int node, int dest, double now, pkt_t *packet,
+                  int *next, double *arrival, emulator_stats_t *stats);
+/* accounts the buffers up to the end of the run at time now */
+void topology_finish(topology_t *topology, double now);
+void topology_close(topology_t *topology);
+
+#endif
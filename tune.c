@@ -0,0 +1,325 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "emulator.h"
+#include "latency.h"
+#include "link.h"
+#include "options.h"
+#include "protocols.h"
+
+/* searches the window and retransmission timeout of a protocol for the */
+/* link and traffic of the options by successive halving: every pair of */
+/* a grid runs on few messages, the better half runs again on twice as  */
+/* many, and so on until one is left, run on all of them.  A pair is    */
+/* better if its p99 latency is within the -M bound and it has more     */
+/* goodput.  Every run of a rung uses the same seed, so the pairs meet  */
+/* the same losses, and runs -P at once, each in a child process as the */
+/* emulator runs one simulation at a time.  The goodput and p99 latency */
+/* frontier of the pairs, each at its last run, then runs again on all  */
+/* the messages, and its best pair is the one printed.  The segment    */
+/* size is not searched: a packet carries one message.                 */
+
+#define NWINDOWS 7  /* 1, 2, 4 ... 64 packets */
+#define NTIMEOUTS 8 /* multiples of the round trip time */
+#define MAX_CONFIGS (NWINDOWS * NTIMEOUTS)
+
+static const double timeout_rtts[NTIMEOUTS] = {1, 1.5, 2, 3, 4, 6, 8, 12};
+
+typedef struct result_s
+{
+  int ndelivered;
+  double time;
+  double latency; /* mean */
+  double p99;
+} result_t;
+
+typedef struct config_s
+{
+  int window; /* 0 for the protocol's own */
+  float timeout;
+  int nmsgs;  /* of the last run, 0 before the first */
+  result_t result;
+  int ok;
+  pid_t pid;
+  int fd;     /* the run writes its result_t to */
+} config_t;
+
+static double bound = INFINITY; /* on the p99 latency */
+
+static double wall_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-p protocol] [-P runs] [-M latency] [options]\n", prog);
+  fprintf(stderr, "  -p name     protocol to run:");
+  for (int i = 0; protocols[i] != NULL; i++)
+    fprintf(stderr, " %s", protocols[i]->name);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  -P runs     simulations run at once\n");
+  fprintf(stderr, "  -M latency  bound on the p99 latency, none by default\n");
+  emulator_usage(stderr);
+  exit(1);
+}
+
+static double goodput(const config_t *config)
+{
+  return config->result.time > 0 ? config->result.ndelivered / config->result.time : 0.0;
+}
+
+static int feasible(const config_t *config)
+{
+  return config->ok && config->result.ndelivered > 0 && config->result.p99 <= bound;
+}
+
+/* the better first: those within the bound by goodput then p99, then */
+/* the others by p99, then the runs that failed                       */
+static int by_rank(const void *p, const void *q)
+{
+  const config_t *a = *(const config_t *const *)p, *b = *(const config_t *const *)q;
+
+  if (feasible(a) != feasible(b))
+    return feasible(b) - feasible(a);
+  if (a->ok != b->ok)
+    return b->ok - a->ok;
+  if (feasible(a) && goodput(a) != goodput(b))
+    return goodput(a) < goodput(b) ? 1 : -1;
+  return a->result.p99 < b->result.p99 ? -1 : a->result.p99 > b->result.p99;
+}
+
+/* runs config on nmsgs messages in a child, which writes its result */
+/* to config->fd                                                     */
+static void start_run(const protocol_t *protocol, const emulator_params_t *params,
+                      config_t *config, int nmsgs)
+{
+  emulator_params_t run = *params;
+  emulator_stats_t stats;
+  result_t result;
+  int fds[2];
+
+  config->nmsgs = nmsgs;
+  config->ok = 0;
+  if (pipe(fds) < 0)
+  {
+    perror("pipe");
+    exit(1);
+  }
+  fflush(stdout);
+  if ((config->pid = fork()) < 0)
+  {
+    perror("fork");
+    exit(1);
+  }
+  if (config->pid == 0)
+  {
+    close(fds[0]);
+    run.nsimmax = nmsgs;
+    run.window = config->window;
+    run.timeout = config->timeout;
+    if (emulator_run(protocol, &run, &stats) < 0)
+      _exit(1);
+    result.ndelivered = stats.ndelivered;
+    result.time = stats.time;
+    result.latency = stats.ndelivered > 0 ? stats.latency_sum / stats.ndelivered : 0.0;
+    result.p99 = latency_percentile(&stats.latency, 99);
+    _exit(write(fds[1], &result, sizeof(result)) == sizeof(result) ? 0 : 1);
+  }
+  close(fds[1]);
+  config->fd = fds[0];
+}
+
+/* reads the result of the run of config, which has exited */
+static void finish_run(config_t *config)
+{
+  config->ok = read(config->fd, &config->result, sizeof(result_t)) == sizeof(result_t);
+  close(config->fd);
+}
+
+/* runs the n configs on nmsgs messages, nruns at once */
+static void run_rung(const protocol_t *protocol, const emulator_params_t *params,
+                     config_t **configs, int n, int nmsgs, int nruns)
+{
+  int i, running = 0;
+
+  for (i = 0; i < n; i++)
+  {
+    if (running == nruns)
+    {
+      wait(NULL);
+      running--;
+    }
+    start_run(protocol, params, configs[i], nmsgs);
+    running++;
+  }
+  for (; running > 0; running--)
+    wait(NULL);
+  /* a result fits in the pipe, so the runs did not wait to be read */
+  for (i = 0; i < n; i++)
+    finish_run(configs[i]);
+}
+
+static void print_config(const config_t *config)
+{
+  if (config->window > 0)
+    printf("%7d", config->window);
+  else
+    printf("%7s", "-");
+  printf(" %9.1f %9d", config->timeout, config->nmsgs);
+  if (!config->ok)
+    printf(" %11s\n", "failed");
+  else
+    printf(" %11.5f %11.2f %11.2f%s\n", goodput(config), config->result.latency,
+           config->result.p99, feasible(config) ? "" : " over the bound");
+}
+
+static int by_p99(const void *p, const void *q)
+{
+  const config_t *a = *(const config_t *const *)p, *b = *(const config_t *const *)q;
+
+  return a->result.p99 < b->result.p99 ? -1 : a->result.p99 > b->result.p99;
+}
+
+/* returns whether config ran on nmsgs messages, or on any if 0 */
+static int ran(const config_t *config, int nmsgs)
+{
+  return config->ok && config->nmsgs > 0 && (nmsgs == 0 || config->nmsgs == nmsgs);
+}
+
+/* fills frontier with the n configs that ran on nmsgs, 0 for any, that */
+/* no other has both more goodput and a lower p99 latency than, by p99, */
+/* and returns how many.  Of equal ones it keeps the first.             */
+static int find_frontier(config_t *configs, int n, int nmsgs, config_t **frontier)
+{
+  int i, j, nfrontier = 0, dominated;
+
+  for (i = 0; i < n; i++)
+  {
+    if (!ran(&configs[i], nmsgs))
+      continue;
+    dominated = 0;
+    for (j = 0; j < n && !dominated; j++)
+      dominated = j != i && ran(&configs[j], nmsgs) &&
+                  goodput(&configs[j]) >= goodput(&configs[i]) &&
+                  configs[j].result.p99 <= configs[i].result.p99 &&
+                  (goodput(&configs[j]) > goodput(&configs[i]) ||
+                   configs[j].result.p99 < configs[i].result.p99 || j < i);
+    if (!dominated)
+      frontier[nfrontier++] = &configs[i];
+  }
+  qsort(frontier, nfrontier, sizeof(config_t *), by_p99);
+  return nfrontier;
+}
+
+int main(int argc, char **argv)
+{
+  const protocol_t *protocol = &goback_n_protocol;
+  emulator_params_t params;
+  config_t configs[MAX_CONFIGS], *alive[MAX_CONFIGS], *frontier[MAX_CONFIGS];
+  double rtt, start;
+  int nruns = sysconf(_SC_NPROCESSORS_ONLN), opt, nwindows, n = 0, nalive, nrungs, rung;
+  int i, j, nmsgs, nfrontier;
+
+  emulator_default_params(&params);
+  params.nsimmax = 20000;
+  params.lossprob = 0.02;
+  params.corruptprob = 0.02;
+  params.lambda = 20;
+  params.trace = 0;
+  while ((opt = getopt(argc, argv, "p:P:M:" EMULATOR_OPTIONS)) != -1)
+  {
+    if (opt == 'p')
+    {
+      if ((protocol = find_protocol(optarg)) == NULL)
+        usage(argv[0]);
+    }
+    else if (opt == 'P')
+    {
+      if ((nruns = atoi(optarg)) < 1)
+        usage(argv[0]);
+    }
+    else if (opt == 'M')
+    {
+      if ((bound = atof(optarg)) <= 0)
+        usage(argv[0]);
+    }
+    else if (emulator_option(opt, optarg, &params) != 1)
+      usage(argv[0]);
+  }
+  if (nruns < 1)
+    nruns = 1;
+
+  /* the timeouts scale with the round trip time of an idle medium */
+  if (params.bandwidth > 0)
+    rtt = 2 * (params.propdelay + LINK_PACKET_BYTES / params.bandwidth);
+  else
+    rtt = 2 * 5.5; /* the random delay is uniform on [1, 10] */
+  /* the alternating bit protocol has no window */
+  nwindows = protocol == &alt_bit_protocol ? 1 : NWINDOWS;
+  for (i = 0; i < nwindows; i++)
+    for (j = 0; j < NTIMEOUTS; j++, n++)
+    {
+      configs[n].window = nwindows > 1 ? 1 << i : 0;
+      configs[n].timeout = rtt * timeout_rtts[j];
+      configs[n].nmsgs = 0;
+      alive[n] = &configs[n];
+    }
+  for (nrungs = 1; 1 << (nrungs - 1) < n; nrungs++)
+    ;
+
+  printf("%s, %d msgs, loss %.3f, corrupt %.3f, lambda %.2f, seed %u\n", protocol->name,
+         params.nsimmax, params.lossprob, params.corruptprob, params.lambda, params.seed);
+  printf("%d windows x %d timeouts from a round trip of %.1f, %d rungs, %d runs at once, ",
+         nwindows, NTIMEOUTS, rtt, nrungs, nruns);
+  if (isinf(bound))
+    printf("no p99 latency bound\n\n");
+  else
+    printf("p99 latency bound %.2f\n\n", bound);
+  printf("%4s %7s %9s %9s %11s %11s\n", "rung", "configs", "msgs", "wall s", "goodput", "p99");
+  for (rung = 0, nalive = n; rung < nrungs; rung++, nalive = (nalive + 1) / 2)
+  {
+    nmsgs = params.nsimmax >> (nrungs - 1 - rung);
+    if (nmsgs < 1)
+      nmsgs = 1;
+    start = wall_clock();
+    run_rung(protocol, &params, alive, nalive, nmsgs, nruns);
+    qsort(alive, nalive, sizeof(config_t *), by_rank);
+    printf("%4d %7d %9d %9.2f %11.5f %11.2f\n", rung, nalive, nmsgs, wall_clock() - start,
+           goodput(alive[0]), alive[0]->result.p99);
+  }
+
+  /* the frontier mixes runs on fewer messages: its pairs run again on */
+  /* all of them, and the best of those is the pair printed            */
+  nfrontier = find_frontier(configs, n, 0, frontier);
+  for (i = 0, nalive = 0; i < nfrontier; i++)
+    if (frontier[i]->nmsgs < params.nsimmax)
+      alive[nalive++] = frontier[i];
+  start = wall_clock();
+  run_rung(protocol, &params, alive, nalive, params.nsimmax, nruns);
+  printf("%4s %7d %9d %9.2f\n", "-", nalive, params.nsimmax, wall_clock() - start);
+  nfrontier = find_frontier(configs, n, params.nsimmax, frontier);
+  if (nfrontier == 0)
+  {
+    printf("\nevery run on all the messages failed\n");
+    return 1;
+  }
+  for (i = 0; i < nfrontier; i++)
+    alive[i] = frontier[i];
+  qsort(alive, nfrontier, sizeof(config_t *), by_rank);
+
+  printf("\n%7s %9s %9s %11s %11s %11s\n", "window", "timeout", "msgs", "goodput", "latency",
+         "p99");
+  print_config(alive[0]);
+  if (!feasible(alive[0]))
+    printf("no configuration is within the bound, this one has the lowest p99 latency\n");
+  printf("\ngoodput and p99 latency frontier, %d pairs:\n", nfrontier);
+  for (i = 0; i < nfrontier; i++)
+    print_config(frontier[i]);
+  return 0;
+}
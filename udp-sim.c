@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "emulator.h"
+#include "latency.h"
+#include "options.h"
+#include "protocols.h"
+#include "udp.h"
+
+/* runs a single protocol over loopback UDP sockets and prints its */
+/* packet rate and system call cost                                */
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-p protocol] [-U usec] [options]\n", prog);
+  fprintf(stderr, "  -p name     protocol to run:");
+  for (int i = 0; protocols[i] != NULL; i++)
+    fprintf(stderr, " %s", protocols[i]->name);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  -U usec     microseconds of real time per time unit\n");
+  emulator_usage(stderr);
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  const protocol_t *protocol = &goback_n_protocol;
+  emulator_params_t params;
+  emulator_stats_t stats;
+  udp_params_t udp_params;
+  udp_stats_t udp_stats;
+  int opt;
+
+  emulator_default_params(&params);
+  params.trace = 0;
+  udp_default_params(&udp_params);
+  while ((opt = getopt(argc, argv, "p:U:" EMULATOR_OPTIONS)) != -1)
+  {
+    if (opt == 'p')
+    {
+      if ((protocol = find_protocol(optarg)) == NULL)
+        usage(argv[0]);
+    }
+    else if (opt == 'U')
+    {
+      if ((udp_params.time_unit = atof(optarg)) <= 0)
+        usage(argv[0]);
+    }
+    else if (emulator_option(opt, optarg, &params) != 1)
+      usage(argv[0]);
+  }
+
+  if (udp_run(protocol, &params, &udp_params, &stats, &udp_stats) < 0)
+    return 1;
+
+  printf("%s over loopback UDP, %.1f us per time unit\n", protocol->name,
+         udp_params.time_unit);
+  printf("sent to layer3:      %d (%d lost, %d corrupted)\n",
+         stats.ntolayer3, stats.nlost, stats.ncorrupt);
+  if (stats.ncorrupt > 0)
+    printf("corruption:          %ld bit errors, %d corrupted packets undetected\n",
+           stats.nbit_errors, stats.nundetected);
+  printf("delivered to layer5: %d of %d (%d duplicated, %d bad)\n",
+         stats.ndelivered, stats.nsim, stats.nduplicate, stats.nbad);
+  if (stats.nunstamped > 0)
+    printf("unstamped:           %d more delivered too late to time\n", stats.nunstamped);
+  if (stats.ndelivered > 0)
+  {
+    printf("average latency:     %f\n", stats.latency_sum / stats.ndelivered);
+    printf("latency percentiles: %f p50, %f p99, %f p99.9, %f max\n",
+           latency_percentile(&stats.latency, 50), latency_percentile(&stats.latency, 99),
+           latency_percentile(&stats.latency, 99.9), stats.latency.max);
+  }
+  printf("wall time:           %.3f s\n", udp_stats.elapsed);
+  printf("datagrams:           %ld sent, %ld received\n", udp_stats.npackets,
+         udp_stats.nreceived);
+  printf("packets per second:  %.0f\n",
+         udp_stats.elapsed > 0 ? udp_stats.nreceived / udp_stats.elapsed : 0.0);
+  printf("system calls:        %ld (%ld sendmmsg, %ld recvmmsg)\n",
+         udp_stats.nsyscalls, udp_stats.nsendmmsg, udp_stats.nrecvmmsg);
+  if (udp_stats.nreceived > 0)
+    printf("syscalls per packet: %.2f\n",
+           (double)udp_stats.nsyscalls / udp_stats.nreceived);
+  if (protocol->report != NULL)
+    protocol->report();
+  return 0;
+}
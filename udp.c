@@ -0,0 +1,460 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include "backend.h"
+#include "loss.h"
+#include "udp.h"
+
+#define BATCH 64               /* datagrams per sendmmsg/recvmmsg */
+#define WIRE_SIZE (4 * 4 + 20) /* flowid, seqnum, acknum, checksum, payload */
+#define ARRIVAL 2              /* timer index of layer 5 arrivals */
+#define NFDS 5                 /* sockets A, B and timers A, B, ARRIVAL */
+
+static const protocol_t *protocol;
+static emulator_stats_t *stats;
+static udp_stats_t *ustats;
+
+static int fds[NFDS] = {-1, -1, -1, -1, -1};
+static int *sock = fds;      /* sock[AorB] */
+static int *timer = fds + 2; /* timer[AorB], timer[ARRIVAL] */
+static int timer_on[2];
+static int arrival_entity; /* entity the next layer 5 arrival occurs at */
+
+static struct timespec start;
+static float time_unit;
+static loss_model_t loss;
+static bit_errors_t bit_errors[2]; /* of the packets sent by each entity */
+static float corruptprob, ber, lambda;
+static int bidirectional;
+static int nsim, nsimmax;
+static int fec; /* emulator_params_t.fec_group */
+static int handshake; /* emulator_params_t.handshake */
+static int window; /* emulator_params_t.window */
+static float timeout; /* emulator_params_t.timeout */
+
+static char out[2][BATCH][WIRE_SIZE]; /* datagrams waiting for sendmmsg */
+static int nout[2];
+
+void udp_default_params(udp_params_t *params)
+{
+  params->time_unit = 10;
+}
+
+/* time units elapsed since the run started */
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((ts.tv_sec - start.tv_sec) * 1e6 + (ts.tv_nsec - start.tv_nsec) / 1e3) / time_unit;
+}
+
+/* arms fd to expire after delay time units, or disarms it if delay < 0 */
+static void set_timer(int fd, float delay)
+{
+  struct itimerspec its = {0};
+  long ns;
+
+  if (delay >= 0)
+  {
+    ns = delay * time_unit * 1000;
+    if (ns < 1)
+      ns = 1; /* a zero it_value would disarm the timer */
+    its.it_value.tv_sec = ns / 1000000000;
+    its.it_value.tv_nsec = ns % 1000000000;
+  }
+  ustats->nsyscalls++;
+  timerfd_settime(fd, 0, &its, NULL);
+}
+
+static void generate_next_arrival()
+{
+  if (TRACE > 2)
+    printf("          GENERATE NEXT ARRIVAL: creating new arrival\n");
+
+  if (bidirectional && (jimsrand() > 0.5))
+    arrival_entity = B;
+  else
+    arrival_entity = A;
+  set_timer(timer[ARRIVAL], lambda * jimsrand() * 2);
+}
+
+static void flush(int AorB)
+{
+  struct mmsghdr msgs[BATCH];
+  struct iovec iov[BATCH];
+  int i, sent = 0, n;
+
+  if (nout[AorB] == 0)
+    return;
+  memset(msgs, 0, sizeof(msgs));
+  for (i = 0; i < nout[AorB]; i++)
+  {
+    iov[i].iov_base = out[AorB][i];
+    iov[i].iov_len = WIRE_SIZE;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  while (sent < nout[AorB])
+  {
+    ustats->nsyscalls++;
+    ustats->nsendmmsg++;
+    n = sendmmsg(sock[AorB], msgs + sent, nout[AorB] - sent, 0);
+    if (n <= 0)
+    {
+      perror("sendmmsg");
+      break;
+    }
+    sent += n;
+  }
+  ustats->npackets += sent;
+  nout[AorB] = 0;
+}
+
+static void receive(int AorB)
+{
+  struct mmsghdr msgs[BATCH];
+  struct iovec iov[BATCH];
+  char in[BATCH][WIRE_SIZE];
+  pkt_t packet;
+  uint32_t field;
+  int i, n;
+
+  memset(msgs, 0, sizeof(msgs));
+  for (i = 0; i < BATCH; i++)
+  {
+    iov[i].iov_base = in[i];
+    iov[i].iov_len = WIRE_SIZE;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  for (;;)
+  {
+    ustats->nsyscalls++;
+    n = recvmmsg(sock[AorB], msgs, BATCH, MSG_DONTWAIT, NULL);
+    if (n <= 0)
+      return;
+    ustats->nrecvmmsg++;
+    ustats->nreceived += n;
+    for (i = 0; i < n; i++)
+    {
+      if (msgs[i].msg_len != WIRE_SIZE)
+        continue;
+      memcpy(&field, in[i] + 0, 4);
+      packet.flowid = ntohl(field);
+      memcpy(&field, in[i] + 4, 4);
+      packet.seqnum = ntohl(field);
+      memcpy(&field, in[i] + 8, 4);
+      packet.acknum = ntohl(field);
+      memcpy(&field, in[i] + 12, 4);
+      packet.checksum = ntohl(field);
+      memcpy(packet.payload, in[i] + 16, 20);
+      packet.ecn = ECN_NOT_ECT; /* nothing marks the loopback */
+      stats->nevents++;
+      protocol->input(AorB, packet);
+    }
+    flush(A);
+    flush(B);
+    if (n < BATCH)
+      return;
+  }
+}
+
+/* returns 0 once the last message has been generated */
+static int handle_timer(int id)
+{
+  uint64_t expirations;
+  msg_t message;
+  int AorB;
+
+  ustats->nsyscalls++;
+  if (read(timer[id], &expirations, sizeof(expirations)) != sizeof(expirations))
+    return 1; /* stopped or restarted after it expired */
+  stats->nevents++;
+
+  if (id == ARRIVAL)
+  {
+    if (nsim == nsimmax)
+      return 0;
+    AorB = arrival_entity;
+    generate_next_arrival(); /* set up future arrival */
+    layer5_message(&message, nsim, now());
+    nsim++;
+    protocol->output(AorB, 0, message);
+  }
+  else
+  {
+    timer_on[id] = 0;
+    protocol->timerinterrupt(id, 0);
+  }
+  flush(A);
+  flush(B);
+  return 1;
+}
+
+static int open_endpoints()
+{
+  struct sockaddr_in addr[2];
+  socklen_t len;
+  int i, size = 4 << 20;
+
+  for (i = 0; i < 2; i++)
+  {
+    if ((sock[i] = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+      return -1;
+    setsockopt(sock[i], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    memset(&addr[i], 0, sizeof(addr[i]));
+    addr[i].sin_family = AF_INET;
+    addr[i].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    len = sizeof(addr[i]);
+    if (bind(sock[i], (struct sockaddr *)&addr[i], len) < 0 ||
+        getsockname(sock[i], (struct sockaddr *)&addr[i], &len) < 0)
+      return -1;
+  }
+  /* A and B only ever talk to each other */
+  for (i = 0; i < 2; i++)
+    if (connect(sock[i], (struct sockaddr *)&addr[(i + 1) % 2], sizeof(addr[i])) < 0)
+      return -1;
+  for (i = 0; i < 3; i++)
+    if ((timer[i] = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK)) < 0)
+      return -1;
+  return 0;
+}
+
+int udp_run(const protocol_t *run_protocol, const emulator_params_t *params,
+            const udp_params_t *udp_params, emulator_stats_t *run_stats,
+            udp_stats_t *run_ustats)
+{
+  struct epoll_event ev, events[NFDS];
+  int epfd = -1, i, n, running = 1, status = -1;
+
+  if (params->nflows != 1)
+  {
+    fprintf(stderr, "udp_run: only a single flow is supported\n");
+    return -1;
+  }
+  if (params->bandwidth > 0 || params->record != NULL || params->samples != NULL ||
+      params->pcap != NULL || params->profile || params->topology != NULL ||
+      params->rcvbuf > 0 || params->arrival[A] != ARRIVAL_UNIFORM ||
+      params->arrival[B] != ARRIVAL_UNIFORM || params->drain)
+  {
+    fprintf(stderr, "udp_run: the link model, topologies, recording, sampling, capture, "
+                    "profiling, receive buffers, arrival models and draining are not supported\n");
+    return -1;
+  }
+
+  protocol = run_protocol;
+  stats = run_stats;
+  ustats = run_ustats;
+  *stats = (emulator_stats_t){0};
+  *ustats = (udp_stats_t){0};
+  nsimmax = params->nsimmax;
+  corruptprob = params->corruptprob;
+  ber = params->ber;
+  lambda = params->lambda;
+  bidirectional = params->bidirectional;
+  fec = params->fec_group;
+  handshake = params->handshake;
+  window = params->window;
+  timeout = params->timeout;
+  TRACE = params->trace;
+  time_unit = udp_params->time_unit;
+  nsim = 0;
+  nout[A] = nout[B] = 0;
+  timer_on[A] = timer_on[B] = 0;
+
+  init_random(params->seed);
+  layer5_reset();
+  if (ber > 0)
+  {
+    bit_errors_init(&bit_errors[A], ber);
+    bit_errors_init(&bit_errors[B], ber);
+  }
+  if (loss_open(&loss, params) < 0)
+    return -1;
+  if (open_endpoints() < 0 || (epfd = epoll_create1(0)) < 0)
+  {
+    perror("udp_run");
+    goto terminate;
+  }
+  for (i = 0; i < NFDS; i++)
+  {
+    ev.events = EPOLLIN;
+    ev.data.u32 = i;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i], &ev) < 0)
+    {
+      perror("epoll_ctl");
+      goto terminate;
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  protocol->init(A);
+  protocol->init(B);
+  generate_next_arrival();
+  flush(A);
+  flush(B);
+
+  while (running)
+  {
+    ustats->nsyscalls++;
+    n = epoll_wait(epfd, events, NFDS, -1);
+    for (i = 0; i < n && running; i++)
+    {
+      if (events[i].data.u32 < 2)
+        receive(events[i].data.u32);
+      else
+        running = handle_timer(events[i].data.u32 - 2);
+    }
+  }
+  status = 0;
+
+  stats->time = now();
+  stats->nsim = nsim;
+  ustats->elapsed = stats->time * time_unit / 1e6;
+  if (TRACE > 0)
+    printf(" Simulator terminated at time %f\n after sending %d msgs from layer5\n", stats->time, nsim);
+
+terminate:
+  loss_close(&loss);
+  if (epfd >= 0)
+    close(epfd);
+  for (i = 0; i < NFDS; i++)
+  {
+    if (fds[i] >= 0)
+      close(fds[i]);
+    fds[i] = -1;
+  }
+  return status;
+}
+
+/********************** Student-callable ROUTINES ***********************/
+
+/* the UDP backend carries a single flow, so flowid is always 0 */
+void stoptimer(int AorB, int flowid)
+{
+  (void)flowid;
+  if (TRACE > 2)
+    printf("          STOP TIMER: stopping timer at %f\n", now());
+  if (!timer_on[AorB])
+  {
+    printf("Warning: unable to cancel your timer. It wasn't running.\n");
+    return;
+  }
+  set_timer(timer[AorB], -1);
+  timer_on[AorB] = 0;
+}
+
+void starttimer(int AorB, int flowid, float increment)
+{
+  (void)flowid;
+  if (TRACE > 2)
+    printf("          START TIMER: starting timer at %f\n", now());
+  if (timer_on[AorB])
+  {
+    printf("Warning: attempt to start a timer that is already started\n");
+    return;
+  }
+  set_timer(timer[AorB], increment);
+  timer_on[AorB] = 1;
+}
+
+void tolayer3(int AorB, pkt_t packet)
+{
+  uint32_t field;
+  char *wire;
+  double delay;
+  int nbits, corrupted;
+
+  stats->ntolayer3++;
+
+  /* simulate losses (the loopback sets the delay, not a trace): */
+  if (loss_draw(&loss, AorB, &delay, stats))
+  {
+    stats->nlost++;
+    if (TRACE > 0)
+      printf("          TOLAYER3: packet being lost\n");
+    return;
+  }
+
+  /* simulate corruption: */
+  corrupted = 0;
+  if (ber > 0)
+  {
+    nbits = corrupt_bits(&bit_errors[AorB], &packet);
+    stats->nbit_errors += nbits;
+    corrupted = nbits > 0;
+  }
+  else if (jimsrand() < corruptprob)
+  {
+    corrupt_packet(&packet, jimsrand());
+    corrupted = 1;
+  }
+  if (corrupted)
+  {
+    stats->ncorrupt++;
+    if (protocol->is_corrupted != NULL && !protocol->is_corrupted(&packet))
+      stats->nundetected++;
+    if (TRACE > 0)
+      printf("          TOLAYER3: packet being corrupted\n");
+  }
+
+  wire = out[AorB][nout[AorB]++];
+  field = htonl(packet.flowid);
+  memcpy(wire + 0, &field, 4);
+  field = htonl(packet.seqnum);
+  memcpy(wire + 4, &field, 4);
+  field = htonl(packet.acknum);
+  memcpy(wire + 8, &field, 4);
+  field = htonl(packet.checksum);
+  memcpy(wire + 12, &field, 4);
+  memcpy(wire + 16, packet.payload, 20);
+  if (nout[AorB] == BATCH)
+    flush(AorB);
+}
+
+void tolayer5(int AorB, int flowid, char *datasent)
+{
+  (void)AorB;
+  (void)flowid;
+  layer5_deliver(stats, datasent, now());
+}
+
+int layer5_window(int AorB, int flowid)
+{
+  (void)AorB;
+  (void)flowid;
+  return -1;
+}
+
+double current_time()
+{
+  return now();
+}
+
+int fec_group()
+{
+  return fec;
+}
+
+int handshake_mode()
+{
+  return handshake;
+}
+
+int send_window()
+{
+  return window;
+}
+
+float retransmit_timeout()
+{
+  return timeout;
+}
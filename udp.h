@@ -0,0 +1,42 @@
+#ifndef UDP_H
+#define UDP_H
+#include "emulator.h"
+
+/* ******************************************************************
+ LOOPBACK UDP BACKEND
+
+   Runs the protocol_t entities A and B as two UDP endpoints on
+   127.0.0.1 instead of inside the event-list emulator.  tolayer3()
+   sends a real datagram (bursts from one callback go out in a single
+   sendmmsg), arrivals are read with recvmmsg, and timers are timerfds,
+   all driven by one epoll loop.  Loss and corruption are injected in
+   process with the emulator's models before a packet is sent; the
+   delays of a loss trace are not applied.
+   Only a single flow (emulator_params_t.nflows == 1) is supported, and
+   the link model (bandwidth > 0), topologies, recording, sampling,
+   capture, profiling, receive buffers (rcvbuf > 0), arrival models other than
+   ARRIVAL_UNIFORM and draining are not.
+**********************************************************************/
+
+typedef struct udp_params_s
+{
+  float time_unit; /* microseconds of real time per emulator time unit */
+} udp_params_t;
+
+typedef struct udp_stats_s
+{
+  double elapsed;  /* wall clock seconds */
+  long npackets;   /* datagrams sent */
+  long nreceived;  /* datagrams received */
+  long nsyscalls;  /* every system call made by the event loop */
+  long nsendmmsg;  /* sendmmsg calls */
+  long nrecvmmsg;  /* recvmmsg calls that returned datagrams */
+} udp_stats_t;
+
+void udp_default_params(udp_params_t *params);
+/* returns 0, or -1 if the sockets or event loop can not be set up */
+int udp_run(const protocol_t *protocol, const emulator_params_t *params,
+            const udp_params_t *udp_params, emulator_stats_t *stats,
+            udp_stats_t *udp_stats);
+
+#endif